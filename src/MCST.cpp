@@ -6,10 +6,75 @@
 #include <fstream>
 #include <string>
 #include <cstdlib>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <vector>
+#include <algorithm>
 
 // static r64 g_tuned_exploration_factor_weight = 0.422;
 static r64 g_tuned_exploration_factor_weight = 1.0;
-static r64 UCT(Node *node)
+static r64 UCT(r64 value, u32 num_simulations, u32 parent_num_simulations, ControlledType controlled_type)
+{
+    assert(num_simulations != 0);
+
+    r64 uct;
+    if (controlled_type == ControlledType::CONTROLLED)
+    {
+        uct = EXPLORATION_FACTOR * sqrt(log((r64)parent_num_simulations) / (r64)num_simulations) - value / (r64)num_simulations;
+    }
+    else if (controlled_type == ControlledType::UNCONTROLLED)
+    {
+        uct = EXPLORATION_FACTOR * sqrt(log((r64)parent_num_simulations) / (r64)num_simulations) + value / (r64)num_simulations;
+    }
+    else
+    {
+        UNREACHABLE_CODE;
+    }
+
+    return uct;
+}
+
+// NOTE(david): the statistics of the position are used if it's shared, as they include the simulations through the other move orders as well
+static void GetUCTStatistics(Node *node, NodePool &node_pool, r64 *value, u32 *num_simulations)
+{
+    TranspositionTable::Entry *entry = node_pool.GetTranspositionEntry(node);
+    if (entry == nullptr)
+    {
+        *value = node->value;
+        *num_simulations = node->num_simulations;
+    }
+    else
+    {
+        assert(entry->num_simulations >= node->num_simulations && "every update of the node is also applied to its entry");
+        *value = entry->value;
+        *num_simulations = entry->num_simulations;
+    }
+}
+
+// NOTE(david): the parent's count has to be the sum of the counts its children are compared with, the parent's own entry also counts the simulations of its other move orders, which don't go through these children
+static u32 UCTParentNumSimulations(Node *parent_node, NodePool &node_pool)
+{
+    u32 parent_num_simulations = 0;
+    NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent_node);
+    for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+    {
+        Node *child_node = &children_nodes->children[child_index];
+        if (child_node->is_tombstone)
+        {
+            continue ;
+        }
+        r64 child_value;
+        u32 child_num_simulations;
+        GetUCTStatistics(child_node, node_pool, &child_value, &child_num_simulations);
+        parent_num_simulations += child_num_simulations;
+    }
+
+    return parent_num_simulations;
+}
+
+static r64 UCT(Node *node, NodePool &node_pool, u32 parent_num_simulations)
 {
     /*
         parent num of simulations | max exploration factor (child num of simulation is 1)
@@ -24,7 +89,6 @@ static r64 UCT(Node *node)
     */
     assert(node != nullptr);
     assert(node->parent != nullptr && "don't care about root uct, as the root node isn't a possible move, so there is no reason to compare its uct");
-    assert(node->num_simulations != 0);
 
     // r64 depth_weight = 1.0 / (r32)node->depth;
     // TODO(david): think about this number and how it should affect explitation vs exploration
@@ -32,22 +96,26 @@ static r64 UCT(Node *node)
     // r64 number_of_branches_weight = 0.2 * number_of_branches;
     // r64 number_of_branches_weight = 1.0;
     // r64 weighted_exploration_factor = number_of_branches_weight * g_tuned_exploration_factor_weight * EXPLORATION_FACTOR / (node->depth * depth_weight);
-    assert(node->parent != nullptr);
-    r64 uct;
-    if (node->controlled_type == ControlledType::CONTROLLED)
-    {
-        uct = EXPLORATION_FACTOR * sqrt(log((r64)node->parent->num_simulations) / (r64)node->num_simulations) - (r64)node->value / (r64)node->num_simulations;
-    }
-    else if (node->controlled_type == ControlledType::UNCONTROLLED)
-    {
-        uct = EXPLORATION_FACTOR * sqrt(log((r64)node->parent->num_simulations) / (r64)node->num_simulations) + (r64)node->value / (r64)node->num_simulations;
-    }
-    else
+
+    r64 value;
+    u32 num_simulations;
+    GetUCTStatistics(node, node_pool, &value, &num_simulations);
+    assert(parent_num_simulations >= num_simulations);
+
+    return UCT(value, num_simulations, parent_num_simulations, node->controlled_type);
+}
+
+// NOTE(david): every change to the statistics of a node has to go through here, so that the statistics shared by the node's position stay in sync
+static void AddStatistics(Node *node, NodePool &node_pool, r32 value, i32 num_simulations)
+{
+    node->value += value;
+    node->num_simulations += num_simulations;
+    TranspositionTable::Entry *entry = node_pool.GetTranspositionEntry(node);
+    if (entry != nullptr)
     {
-        UNREACHABLE_CODE;
+        entry->value += value;
+        entry->num_simulations += num_simulations;
     }
-
-    return uct;
 }
 
 static string MoveToWord(Move move)
@@ -56,7 +124,7 @@ static string MoveToWord(Move move)
     {
         return "NONE";
     }
-    return "(" + to_string(move.row) + ", " + to_string(move.col) + ")";
+    return "(" + to_string(move.GetRow()) + ", " + to_string(move.GetCol()) + ")";
 }
 
 static string TerminalTypeToWord(TerminalType terminal_type)
@@ -102,100 +170,252 @@ static string ControlledTypeToWord(ControlledType controlled_type)
     }
 }
 
-template <u32 MoveSize>
-void MoveSequence<MoveSize>::AddMove(Move move)
+thread_local NodePool *debug_node_pool;
+ostream &operator<<(ostream &os, Node *node)
 {
-    assert(moves_left < ArrayCount(MoveSequence::moves) && "not enough space in the move sequence");
-    moves[moves_left++] = move;
+    NodePool::ChildrenTables *children_table = debug_node_pool->GetChildren(node);
+    TerminalDepth *terminal_depth = debug_node_pool->GetTerminalDepth(node);
+    Move highest_move_expanded = Move::MoveFromIndex(children_table->highest_move_index);
+    LOGN(os, "depth: " << node->depth << ", index: " << node->index << ", " << MoveToWord(node->move_to_get_here) << ", value: " << node->value << ", sims: " << node->num_simulations << ", " << ControlledTypeToWord(node->controlled_type) << ", " << TerminalTypeToWord(node->terminal_type) << ", terminal depth(W/L/N): (" << terminal_depth->winning << "," << terminal_depth->losing << "," << terminal_depth->neutral << "), uct: " << (node->parent == nullptr ? 0.0 : UCT(node, *debug_node_pool, UCTParentNumSimulations(node->parent, *debug_node_pool))) << ", highest move index: " << MoveToWord(highest_move_expanded));
+
+    return os;
 }
 
-template <u32 MoveSize>
-Move MoveSequence<MoveSize>::PopMoveAtIndex(u32 move_index)
+void NodePool::ClearChildTable(u32 table_index)
 {
-    assert(moves_left > 0);
-    assert(move_index < moves_left);
-    Move result_move = moves[move_index];
-    moves[move_index] = moves[moves_left - 1];
-    --moves_left;
-
-    return result_move;
+    ChildrenTables *child_table = &_GetSegment(table_index)->children_tables[table_index % node_segment_size];
+    memset(child_table, 0, sizeof(*child_table));
+    child_table->highest_move_index = -1;
 }
 
-NodePool *debug_node_pool;
-ostream &operator<<(ostream &os, Node *node)
+TranspositionTable::TranspositionTable(u64 memory_ceiling_in_bytes)
+    : _entries(nullptr),
+      _size_mask(0),
+      _generation(1)
 {
-    NodePool::ChildrenTables *children_table = debug_node_pool->GetChildren(node);
-    Move highest_move_cycled = Move::MoveFromIndex(children_table->highest_move_index);
-    LOGN(os, "depth: " << node->depth << ", index: " << node->index << ", " << MoveToWord(node->move_to_get_here) << ", value: " << node->value << ", sims: " << node->num_simulations << ", " << ControlledTypeToWord(node->controlled_type) << ", " << TerminalTypeToWord(node->terminal_info.terminal_type) << ", terminal depth(W/L/N): (" << node->terminal_info.terminal_depth.winning << "," << node->terminal_info.terminal_depth.losing << "," << node->terminal_info.terminal_depth.neutral << "), uct: " << (node->parent == nullptr ? 0.0 : UCT(node)) << ", highest move index: " << MoveToWord(highest_move_cycled));
+    u64 number_of_entries = 1;
+    while (2 * number_of_entries * sizeof(Entry) <= memory_ceiling_in_bytes && 2 * number_of_entries <= ((u64)1 << 31))
+    {
+        number_of_entries *= 2;
+    }
+    if (number_of_entries * sizeof(Entry) > memory_ceiling_in_bytes)
+    {
+        // NOTE(david): no room for the table, the nodes don't share their statistics
+        return ;
+    }
+    // NOTE(david): zeroed pages are only backed by memory once they are used
+    _entries = (Entry *)calloc(number_of_entries, sizeof(Entry));
+    if (_entries == nullptr)
+    {
+        throw runtime_error("failed to allocate the transposition table");
+    }
+    _size_mask = (u32)(number_of_entries - 1);
+}
 
-    return os;
+TranspositionTable::~TranspositionTable()
+{
+    free(_entries);
 }
 
-static u32 GetNextPowerOfTwo(u32 number)
+u32 TranspositionTable::AcquireEntry(u64 key)
 {
-    u32 result = pow(2.0, ceil(log2(number)));
+    if (_entries == nullptr)
+    {
+        return invalid_entry_index;
+    }
 
-    return result;
+    u32 free_entry_index = invalid_entry_index;
+    u32 entry_index = (u32)key & _size_mask;
+    for (u32 probe_index = 0; probe_index < max_probe_length; ++probe_index)
+    {
+        Entry *entry = &_entries[entry_index];
+        if (entry->generation != _generation)
+        {
+            // NOTE(david): not used since the last clear, so the key isn't further down the probe sequence
+            if (free_entry_index == invalid_entry_index)
+            {
+                free_entry_index = entry_index;
+            }
+            break ;
+        }
+        if (entry->key == key)
+        {
+            ++entry->number_of_nodes;
+            return entry_index;
+        }
+        if (entry->number_of_nodes == 0 && free_entry_index == invalid_entry_index)
+        {
+            free_entry_index = entry_index;
+        }
+        entry_index = (entry_index + 1) & _size_mask;
+    }
+
+    if (free_entry_index != invalid_entry_index)
+    {
+        Entry *entry = &_entries[free_entry_index];
+        entry->key = key;
+        entry->value = 0.0f;
+        entry->num_simulations = 0;
+        entry->number_of_nodes = 1;
+        entry->generation = _generation;
+    }
+
+    return free_entry_index;
 }
 
-void NodePool::ClearChildTable(u32 table_index)
+void TranspositionTable::ReleaseEntry(u32 entry_index, r32 value, u32 num_simulations)
 {
-    assert(table_index < _number_of_nodes_allocated);
-    ChildrenTables *child_table = &_move_to_node_tables[table_index];
-    memset(child_table, 0, sizeof(*child_table));
-    child_table->highest_move_index = -1;
+    if (entry_index == invalid_entry_index)
+    {
+        return ;
+    }
+    Entry *entry = &_entries[entry_index];
+    assert(entry->number_of_nodes > 0);
+    assert(entry->num_simulations >= num_simulations);
+    --entry->number_of_nodes;
+    if (entry->number_of_nodes == 0)
+    {
+        // NOTE(david): set rather than subtracted, so that the rounding errors of the value don't carry over to the next node of the position
+        entry->value = 0.0f;
+        entry->num_simulations = 0;
+    }
+    else
+    {
+        entry->value -= value;
+        entry->num_simulations -= num_simulations;
+    }
+}
+
+TranspositionTable::Entry *TranspositionTable::GetEntry(u32 entry_index)
+{
+    if (entry_index == invalid_entry_index)
+    {
+        return nullptr;
+    }
+
+    return &_entries[entry_index];
 }
 
-NodePool::NodePool(NodeIndex number_of_nodes_to_allocate)
-    : _number_of_nodes_allocated(number_of_nodes_to_allocate),
-      _available_node_index(0),
-      _free_nodes_index(-1),
-      _total_number_of_freed_nodes(0)
+void TranspositionTable::Clear(void)
 {
-    u32 node_alignment = GetNextPowerOfTwo(sizeof(*_nodes));
-    _nodes = (Node *)_aligned_malloc(_number_of_nodes_allocated * sizeof(*_nodes), node_alignment);
-    if (_nodes == nullptr)
+    if (_entries == nullptr)
+    {
+        return ;
+    }
+
+    // NOTE(david): the entries of the previous generations count as never used, so only the pages that are probed again are touched
+    ++_generation;
+    if (_generation == 0)
     {
-        throw runtime_error("couldn't allocate _nodes in NodePool");
+        // NOTE(david): wrapped around, the entries of the old generations could be mistaken for the new ones
+        memset(_entries, 0, Size());
+        _generation = 1;
     }
+}
 
-    u32 move_to_node_hash_table_alignment = GetNextPowerOfTwo(sizeof(*_move_to_node_tables));
-    _move_to_node_tables = (ChildrenTables *)_aligned_malloc(_number_of_nodes_allocated * sizeof(*_move_to_node_tables), move_to_node_hash_table_alignment);
-    if (_move_to_node_tables == nullptr)
+u64 TranspositionTable::Size(void)
+{
+    if (_entries == nullptr)
     {
-        throw runtime_error("couldn't allocate _move_to_node_tables in NodePool");
+        return 0;
     }
 
-    u32 nodes_free_list_alignment = GetNextPowerOfTwo(sizeof(*_free_nodes));
-    _free_nodes = (NodeIndex *)_aligned_malloc(_number_of_nodes_allocated * sizeof(*_free_nodes), nodes_free_list_alignment);
-    if (_free_nodes == nullptr)
+    return ((u64)_size_mask + 1) * sizeof(Entry);
+}
+
+NodePool::NodePool(u64 memory_ceiling_in_bytes)
+    : _transposition_table(memory_ceiling_in_bytes / transposition_table_memory_divisor)
+{
+    _max_number_of_segments = (u32)((memory_ceiling_in_bytes - _transposition_table.Size()) / sizeof(NodeSegment));
+    if (_max_number_of_segments == 0)
     {
-        throw runtime_error("couldn't allocate _move_to_node_tables in NodePool");
+        throw runtime_error("memory ceiling of NodePool is less than a segment");
     }
+    _max_number_of_nodes = _max_number_of_segments * node_segment_size;
 
-    for (u32 child_table_index = 0; child_table_index < _number_of_nodes_allocated; ++child_table_index)
+    _segments = new NodeSegment *[_max_number_of_segments];
+    for (u32 segment_index = 0; segment_index < _max_number_of_segments; ++segment_index)
     {
-        ClearChildTable(child_table_index);
+        _segments[segment_index] = nullptr;
     }
+
+    _ClearFreeBlocks();
 }
 
 NodePool::~NodePool()
 {
-    assert(_nodes);
-    assert(_move_to_node_tables);
-    assert(_free_nodes);
+    assert(_segments);
+
+    for (u32 segment_index = 0; segment_index < _max_number_of_segments; ++segment_index)
+    {
+        if (_segments[segment_index] != nullptr)
+        {
+            _aligned_free(_segments[segment_index]);
+        }
+    }
+    delete[] _segments;
+}
+
+bool NodePool::_AllocateSegment(u32 segment_index)
+{
+    assert(segment_index < _max_number_of_segments);
+    if (_segments[segment_index] != nullptr)
+    {
+        return true;
+    }
+
+    NodeSegment *segment = (NodeSegment *)_aligned_malloc(sizeof(*segment), 64);
+    if (segment == nullptr)
+    {
+        return false;
+    }
+    for (NodeIndex node_offset = 0; node_offset < node_segment_size; ++node_offset)
+    {
+        segment->nodes[node_offset].index = segment_index * node_segment_size + node_offset;
+        ChildrenTables *child_table = &segment->children_tables[node_offset];
+        memset(child_table, 0, sizeof(*child_table));
+        child_table->highest_move_index = -1;
+        segment->free_blocks[node_offset] = invalid_node_index;
+    }
+    _segments[segment_index] = segment;
+
+    return true;
+}
+
+NodePool::NodeSegment *NodePool::_GetSegment(NodeIndex node_index)
+{
+    assert(node_index >= 0 && node_index < _max_number_of_nodes);
+    NodeSegment *segment = _segments[node_index / node_segment_size];
+    assert(segment != nullptr);
+
+    return segment;
+}
+
+void NodePool::_ClearFreeBlocks(void)
+{
+    _available_node_index = 0;
+    for (u32 block_size = 0; block_size < ArrayCount(_free_blocks_heads); ++block_size)
+    {
+        _free_blocks_heads[block_size] = invalid_node_index;
+    }
+    _number_of_allocated_nodes = 0;
+    _number_of_freed_nodes = 0;
+    _failed_block_size = 0;
+}
 
-    _aligned_free(_nodes);
-    _aligned_free(_move_to_node_tables);
-    _aligned_free(_free_nodes);
+void NodePool::_PushFreeBlock(NodeIndex block_index, u32 block_size)
+{
+    assert(block_size > 0 && block_size < ArrayCount(_free_blocks_heads));
+    _GetSegment(block_index)->free_blocks[block_index % node_segment_size] = _free_blocks_heads[block_size];
+    _free_blocks_heads[block_size] = block_index;
 }
 
-static Node *InitializeNode(Node *node, Node *parent)
+static Node *InitializeNode(Node *node, TerminalDepth *terminal_depth, Node *parent)
 {
     // NOTE(david): can't 0 out the Node struct here, as the index is persistent
-    // TODO(david): separate persistent and transient data in Node
     node->value = 0.0;
     node->num_simulations = 0;
+    node->num_virtual_losses = 0;
     node->parent = parent;
     if (parent)
     {
@@ -205,88 +425,199 @@ static Node *InitializeNode(Node *node, Node *parent)
     {
         node->depth = 0;
     }
-    node->terminal_info.terminal_type = TerminalType::NOT_TERMINAL;
-    node->terminal_info.terminal_depth = {};
-    node->terminal_info.terminal_depth.winning_continuation.Invalidate();
-    node->terminal_info.terminal_depth.losing_continuation.Invalidate();
-    node->terminal_info.terminal_depth.neutral_continuation.Invalidate();
+    node->is_tombstone = false;
+    node->terminal_type = TerminalType::NOT_TERMINAL;
+    node->transposition_entry_index = TranspositionTable::invalid_entry_index;
+    *terminal_depth = {};
+    terminal_depth->winning_continuation.Invalidate();
+    terminal_depth->losing_continuation.Invalidate();
+    terminal_depth->neutral_continuation.Invalidate();
     node->controlled_type = ControlledType::NONE;
     node->move_to_get_here.Invalidate();
 
     return node;
 }
 
-Node *NodePool::AllocateNode(Node *parent)
+NodeIndex NodePool::_PopFreeBlock(u32 block_size)
+{
+    NodeIndex block_index = _free_blocks_heads[block_size];
+    if (block_index != invalid_node_index)
+    {
+        _free_blocks_heads[block_size] = _GetSegment(block_index)->free_blocks[block_index % node_segment_size];
+    }
+
+    return block_index;
+}
+
+bool NodePool::_CanBumpBlock(u32 block_size)
 {
-    Node *result_node = nullptr;
+    NodeIndex segment_remainder = node_segment_size - _available_node_index % node_segment_size;
+    if (segment_remainder >= (NodeIndex)block_size)
+    {
+        return _available_node_index + (NodeIndex)block_size <= _max_number_of_nodes;
+    }
+
+    return _available_node_index + segment_remainder + (NodeIndex)block_size <= _max_number_of_nodes;
+}
 
-    if (_free_nodes_index >= 0)
+NodeIndex NodePool::_BumpBlock(u32 block_size)
+{
+    if (_CanBumpBlock(block_size) == false)
     {
-        u32 node_index = _free_nodes[_free_nodes_index];
-        result_node = &_nodes[node_index];
-        --_free_nodes_index;
+        return invalid_node_index;
     }
-    else if (_available_node_index < _number_of_nodes_allocated)
+    NodeIndex segment_remainder = node_segment_size - _available_node_index % node_segment_size;
+    if (segment_remainder < (NodeIndex)block_size)
     {
-        result_node = &_nodes[_available_node_index];
-        result_node->index = _available_node_index;
-        ++_available_node_index;
+        // NOTE(david): the rest of the segment is too small for the block, keep it as a smaller free block
+        _PushFreeBlock(_available_node_index, segment_remainder);
+        _available_node_index += segment_remainder;
     }
-    else
+    if (_AllocateSegment(_available_node_index / node_segment_size) == false)
+    {
+        return invalid_node_index;
+    }
+    NodeIndex block_index = _available_node_index;
+    _available_node_index += block_size;
+
+    return block_index;
+}
+
+Node *NodePool::_AllocateBlock(u32 block_size)
+{
+    assert(block_size > 0 && block_size <= max_children_block_size);
+
+    NodeIndex block_index = _PopFreeBlock(block_size);
+    if (block_index == invalid_node_index)
+    {
+        block_index = _BumpBlock(block_size);
+    }
+    if (block_index == invalid_node_index)
     {
-        throw runtime_error("NodePool out of nodes to allocate from!");
+        // NOTE(david): at the memory ceiling, free blocks are only reusable for their own size, so split a larger one
+        for (u32 larger_block_size = block_size + 1; larger_block_size <= max_children_block_size; ++larger_block_size)
+        {
+            block_index = _PopFreeBlock(larger_block_size);
+            if (block_index != invalid_node_index)
+            {
+                _PushFreeBlock(block_index + block_size, larger_block_size - block_size);
+                break ;
+            }
+        }
+    }
+    if (block_index == invalid_node_index)
+    {
+        _failed_block_size = block_size;
+        return nullptr;
     }
+    _number_of_allocated_nodes += block_size;
+
+    return &_GetSegment(block_index)->nodes[block_index % node_segment_size];
+}
 
-    InitializeNode(result_node, parent);
+Node *NodePool::AllocateRootNode(u64 position_key)
+{
+    Node *result_node = _AllocateBlock(1);
+    if (result_node == nullptr)
+    {
+        throw runtime_error("NodePool out of nodes to allocate the root from!");
+    }
+    InitializeNode(result_node, GetTerminalDepth(result_node), nullptr);
+    result_node->transposition_entry_index = _transposition_table.AcquireEntry(position_key);
 
     return result_node;
 }
 
 void NodePool::FreeNodeHelper(Node *node)
 {
-    ++_total_number_of_freed_nodes;
-    ++_free_nodes_index;
-    _free_nodes[_free_nodes_index] = node->index;
-    
     ChildrenTables *children_table = GetChildren(node);
-    for (u32 child_index = 0; child_index < children_table->number_of_children; ++child_index)
+    if (children_table->children != nullptr)
     {
-        assert(children_table->children[child_index] != nullptr);
-        FreeNodeHelper(children_table->children[child_index]);
+        NodeIndex block_index = children_table->children->index;
+        u32 block_size = children_table->capacity;
+        for (u32 child_index = 0; child_index < children_table->number_of_children; ++child_index)
+        {
+            Node *child_node = &children_table->children[child_index];
+            if (child_node->is_tombstone == false)
+            {
+                FreeNodeHelper(child_node);
+                _transposition_table.ReleaseEntry(child_node->transposition_entry_index, child_node->value, child_node->num_simulations);
+            }
+        }
+        _number_of_freed_nodes += block_size;
+        _PushFreeBlock(block_index, block_size);
     }
     ClearChildTable(node->index);
 }
 
 void NodePool::FreeNode(Node *node)
 {
+    assert(node->is_tombstone == false);
+    FreeNodeHelper(node);
+    _transposition_table.ReleaseEntry(node->transposition_entry_index, node->value, node->num_simulations);
     if (node->parent)
     {
-        ChildrenTables *children_table = &_move_to_node_tables[node->parent->index];
-        bool debug_make_sure_child_is_found = false;
-        for (u32 child_index = 0; child_index < children_table->number_of_children; ++child_index)
-        {
-            if (children_table->children[child_index] == node)
-            {
-                children_table->children[child_index] = children_table->children[children_table->number_of_children - 1];
-                children_table->children[children_table->number_of_children - 1] = nullptr;
-                --children_table->number_of_children;
-                debug_make_sure_child_is_found = true;
-                break ;
-            }
-        }
-        assert(debug_make_sure_child_is_found == true);
+        node->is_tombstone = true;
+    }
+    else
+    {
+        _number_of_freed_nodes += 1;
+        _PushFreeBlock(node->index, 1);
     }
+}
+
+void NodePool::FreeChildren(Node *node)
+{
+    assert(node->is_tombstone == false);
     FreeNodeHelper(node);
 }
 
-void NodePool::AddChild(Node *node, Node *child, Move move)
+Node *NodePool::DetachNode(Node *node)
 {
-    ChildrenTables *table = &_move_to_node_tables[node->index];
-    assert(table->number_of_children < ArrayCount(ChildrenTables::children));
-    assert(table->children[table->number_of_children] == nullptr);
-    table->children[table->number_of_children] = child;
+    assert(node->parent != nullptr && "root node is already detached");
+    assert(node->is_tombstone == false);
 
+    Node *detached_node = _AllocateBlock(1);
+    if (detached_node == nullptr)
+    {
+        return nullptr;
+    }
+    NodeIndex detached_node_index = detached_node->index;
+    *detached_node = *node;
+    detached_node->index = detached_node_index;
+    detached_node->parent = nullptr;
+    *GetTerminalDepth(detached_node) = *GetTerminalDepth(node);
+    *GetChildren(detached_node) = *GetChildren(node);
+    ClearChildTable(node->index);
+    node->is_tombstone = true;
+
+    ChildrenTables *children_table = GetChildren(detached_node);
+    for (u32 child_index = 0; child_index < children_table->number_of_children; ++child_index)
+    {
+        children_table->children[child_index].parent = detached_node;
+    }
+
+    return detached_node;
+}
+
+Node *NodePool::AddChild(Node *node, Move move, u32 number_of_legal_moves, u64 position_key)
+{
+    ChildrenTables *table = GetChildren(node);
+    if (table->children == nullptr)
+    {
+        assert(table->number_of_children == 0);
+        table->children = _AllocateBlock(number_of_legal_moves);
+        if (table->children == nullptr)
+        {
+            return nullptr;
+        }
+        table->capacity = number_of_legal_moves;
+    }
+    assert(table->capacity == number_of_legal_moves && "the number of legal moves from a node doesn't change");
+    assert(table->number_of_children < table->capacity);
+    Node *child = &table->children[table->number_of_children];
     ++table->number_of_children;
+    InitializeNode(child, GetTerminalDepth(child), node);
 
     assert(move.IsValid());
     u32 move_index = move.GetIndex();
@@ -294,73 +625,207 @@ void NodePool::AddChild(Node *node, Node *child, Move move)
     table->highest_move_index = move_index;
 
     child->move_to_get_here = move;
+
+    child->transposition_entry_index = _transposition_table.AcquireEntry(position_key);
+
+    return child;
 }
 
 NodePool::ChildrenTables *NodePool::GetChildren(Node *node)
 {
-    assert(node->index >= 0 && node->index < _available_node_index);
-    return (&_move_to_node_tables[node->index]);
+    return (&_GetSegment(node->index)->children_tables[node->index % node_segment_size]);
+}
+
+TerminalDepth *NodePool::GetTerminalDepth(Node *node)
+{
+    return (&_GetSegment(node->index)->terminal_depths[node->index % node_segment_size]);
+}
+
+TranspositionTable::Entry *NodePool::GetTranspositionEntry(Node *node)
+{
+    return _transposition_table.GetEntry(node->transposition_entry_index);
 }
 
 void NodePool::Clear()
 {
-    for (u32 table_index = 0; table_index < _available_node_index; ++table_index)
+    // NOTE(david): the segments are kept for the next search
+    NodeIndex number_of_used_nodes = min(_available_node_index, _max_number_of_nodes);
+    for (NodeIndex table_index = 0; table_index < number_of_used_nodes; ++table_index)
     {
         ClearChildTable(table_index);
     }
-    _available_node_index = 0;
-    _free_nodes_index = -1;
-    _total_number_of_freed_nodes = 0;
+    _ClearFreeBlocks();
+    _transposition_table.Clear();
 }
 
 u32 NodePool::TotalNumberOfFreedNodes(void)
 {
-    return _total_number_of_freed_nodes;
+    return _number_of_freed_nodes;
 }
 
 u32 NodePool::CurrentAllocatedNodes(void)
 {
-    u32 current_available_free_nodes = _free_nodes_index + 1;
+    assert(_number_of_allocated_nodes >= _number_of_freed_nodes);
+    return _number_of_allocated_nodes - _number_of_freed_nodes;
+}
 
-    assert(_available_node_index >= current_available_free_nodes);
-    return _available_node_index - current_available_free_nodes;
+NodeIndex NodePool::MaxNumberOfNodes(void)
+{
+    return _max_number_of_nodes;
 }
 
-static void DebugPrintDecisionTreeHelper(Node *from_node, Player player_to_move, ofstream &tree_fs, NodePool &node_pool)
+u32 NodePool::FailedBlockSize(void)
 {
-    if (from_node->depth > 6)
+    return _failed_block_size;
+}
+
+void NodePool::ResetFailedBlockSize(void)
+{
+    _failed_block_size = 0;
+}
+
+bool NodePool::CanAllocateBlock(u32 block_size)
+{
+    assert(block_size > 0 && block_size <= max_children_block_size);
+    if (_CanBumpBlock(block_size))
     {
-        return ;
+        return true;
     }
-    LOG(tree_fs, string(from_node->depth * 4, ' ') << "(player to move: " << PlayerToWord(player_to_move) << ", " << from_node << ")");
-
-    NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(from_node);
-    for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+    // NOTE(david): same as in _AllocateBlock, a larger free block is split if there is no free block of the size
+    for (u32 free_block_size = block_size; free_block_size <= max_children_block_size; ++free_block_size)
     {
-        Node *child_node = children_nodes->children[child_index];
-        assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
-
-        DebugPrintDecisionTreeHelper(child_node, player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE, tree_fs, node_pool);
+        if (_free_blocks_heads[free_block_size] != invalid_node_index)
+        {
+            return true;
+        }
     }
+
+    return false;
 }
 
-static void DebugPrintDecisionTree(Node *from_node, u32 move_counter, NodePool &node_pool, const GameState &game_state)
+void NodePool::_MarkFreeBlocks(NodeIndex first_block_index, u32 block_size, vector<u64> &is_free_node)
 {
-    ofstream tree_fs("debug/trees/tree" + to_string(move_counter));
-    DebugPrintDecisionTreeHelper(from_node, game_state.player_to_move, tree_fs, node_pool);
+    for (NodeIndex block_index = first_block_index; block_index != invalid_node_index; block_index = _GetSegment(block_index)->free_blocks[block_index % node_segment_size])
+    {
+        for (NodeIndex node_index = block_index; node_index < block_index + (NodeIndex)block_size; ++node_index)
+        {
+            is_free_node[node_index / 64] |= (u64)1 << (node_index % 64);
+        }
+    }
 }
 
-static u32 g_move_counter;
-
-const GameState *debug_game_state;
-
-Node *MCST::SelectBestChild(Node *from_node, NodePool &node_pool)
+void NodePool::CoalesceFreeBlocks(void)
 {
-    Node *selected_node = nullptr;
-
-    ExtremumChildren extremum_children = GetExtremumChildren(from_node, node_pool);
+    // NOTE(david): the free lists are gathered into a bitmap of all the free nodes, then they are rebuilt from the runs of adjacent free nodes
+    // the never used rest of the current segment is merged as well, the next bump starts at the next segment
+    NodeIndex number_of_used_nodes = _available_node_index;
+    if (number_of_used_nodes % node_segment_size != 0)
+    {
+        number_of_used_nodes += node_segment_size - number_of_used_nodes % node_segment_size;
+    }
+    vector<u64> is_free_node((number_of_used_nodes + 63) / 64, 0);
+    for (u32 block_size = 1; block_size <= max_children_block_size; ++block_size)
+    {
+        _MarkFreeBlocks(_free_blocks_heads[block_size], block_size, is_free_node);
+        _free_blocks_heads[block_size] = invalid_node_index;
+    }
+    for (NodeIndex node_index = _available_node_index; node_index < number_of_used_nodes; ++node_index)
+    {
+        is_free_node[node_index / 64] |= (u64)1 << (node_index % 64);
+    }
+    _available_node_index = number_of_used_nodes;
 
-    switch (from_node->controlled_type)
+    NodeIndex run_start = invalid_node_index;
+    for (NodeIndex node_index = 0; node_index <= number_of_used_nodes; ++node_index)
+    {
+        bool is_free = node_index < number_of_used_nodes && (is_free_node[node_index / 64] & ((u64)1 << (node_index % 64))) != 0;
+        // NOTE(david): a block never spans two segments
+        bool is_end_of_run = run_start != invalid_node_index && (is_free == false || node_index % node_segment_size == 0 || node_index - run_start == (NodeIndex)max_children_block_size);
+        if (is_end_of_run)
+        {
+            _PushFreeBlock(run_start, node_index - run_start);
+            run_start = invalid_node_index;
+        }
+        if (is_free && run_start == invalid_node_index)
+        {
+            run_start = node_index;
+        }
+    }
+}
+
+u64 NodePool::CurrentCommittedMemory(void)
+{
+    u64 number_of_segments = 0;
+    for (u32 segment_index = 0; segment_index < _max_number_of_segments; ++segment_index)
+    {
+        if (_segments[segment_index] != nullptr)
+        {
+            ++number_of_segments;
+        }
+    }
+
+    return number_of_segments * sizeof(NodeSegment) + _transposition_table.Size();
+}
+
+static void DebugPrintDecisionTreeHelper(Node *from_node, Player player_to_move, ofstream &tree_fs, NodePool &node_pool)
+{
+    if (from_node->depth > 6)
+    {
+        return ;
+    }
+    LOG(tree_fs, string(from_node->depth * 4, ' ') << "(player to move: " << PlayerToWord(player_to_move) << ", " << from_node << ")");
+
+    NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(from_node);
+    for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+    {
+        Node *child_node = &children_nodes->children[child_index];
+        if (child_node->is_tombstone)
+        {
+            continue ;
+        }
+        assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
+
+        DebugPrintDecisionTreeHelper(child_node, player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE, tree_fs, node_pool);
+    }
+}
+
+static void DebugPrintDecisionTree(Node *from_node, u32 move_counter, NodePool &node_pool, const GameState &game_state, u32 debug_tree_id = 0)
+{
+    ofstream tree_fs("debug/trees/tree" + to_string(move_counter) + (debug_tree_id == 0 ? "" : "_" + to_string(debug_tree_id)));
+    DebugPrintDecisionTreeHelper(from_node, game_state.player_to_move, tree_fs, node_pool);
+}
+
+static u32 g_move_counter;
+
+thread_local const GameState *debug_game_state;
+
+MCST::MCST(bool reuse_tree, u32 number_of_threads, bool evict_cold_subtrees)
+    : _root_node(nullptr),
+      _reuse_tree(reuse_tree),
+      _number_of_threads(number_of_threads),
+      _evict_cold_subtrees(evict_cold_subtrees),
+      _next_eviction_num_simulations(0),
+      _first_random_stream_index(0),
+      _number_of_evaluations(0),
+      _debug_tree_id(0)
+{
+    if (_number_of_threads == 0)
+    {
+        _number_of_threads = 1;
+    }
+    else if (_number_of_threads > max_number_of_search_threads)
+    {
+        _number_of_threads = max_number_of_search_threads;
+    }
+}
+
+Node *MCST::SelectBestChild(Node *from_node, NodePool &node_pool)
+{
+    Node *selected_node = nullptr;
+
+    ExtremumChildren extremum_children = GetExtremumChildren(from_node, node_pool);
+
+    switch (from_node->controlled_type)
     {
         case ControlledType::CONTROLLED: {
             if (extremum_children.best_winning != nullptr)
@@ -419,33 +884,108 @@ Move MCST::Evaluate(const MoveSet &legal_moveset_at_root_node, TerminationPredic
     debug_game_state = &game_state;
     debug_node_pool = &node_pool;
 
-    if (legal_moveset_at_root_node.moves_left == 0)
+    if (legal_moveset_at_root_node.NumberOfMoves() == 0)
     {
         Move move;
         move.Invalidate();
         return move;
     }
-    node_pool.Clear();
-    _root_node = node_pool.AllocateNode(nullptr);
-    // _root_node->controlled_type = ControlledType::CONTROLLED;
-    _root_node->controlled_type = ControlledType::UNCONTROLLED;
+    {
+        // NOTE(david): the other trees of an ensemble read the root statistics under the tree lock while this one is searched
+        lock_guard<mutex> tree_lock(_tree_mutex);
+        if (_reuse_tree == false || _root_node == nullptr)
+        {
+            node_pool.Clear();
+            _root_node = node_pool.AllocateRootNode(game_state.move_to_player_map.zobrist_hash);
+            // _root_node->controlled_type = ControlledType::CONTROLLED;
+            _root_node->controlled_type = ControlledType::UNCONTROLLED;
+        }
+        else
+        {
+            // NOTE(david): continuing from the subtree of the moves played since the last evaluation
+            assert(_root_node->parent == nullptr && _root_node->depth == 0);
+            assert(_root_node->controlled_type == ControlledType::UNCONTROLLED && "the root has to be advanced by a full move (move played and the reply) since the last evaluation");
+        }
+    }
+
+    // NOTE(david): the calling thread is one of the search threads
+    thread helper_threads[max_number_of_search_threads];
+    for (u32 thread_index = 1; thread_index < _number_of_threads; ++thread_index)
+    {
+        helper_threads[thread_index] = thread(&MCST::_SearchWorker, this, thread_index, cref(termination_predicate), cref(simulation_from_state), ref(node_pool), cref(game_state));
+    }
+    _SearchWorker(0, termination_predicate, simulation_from_state, node_pool, game_state);
+    for (u32 thread_index = 1; thread_index < _number_of_threads; ++thread_index)
+    {
+        helper_threads[thread_index].join();
+    }
+    ++_number_of_evaluations;
+
+#if defined(DEBUG_WRITE_OUT)
+    DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, game_state, _debug_tree_id);
+#endif
+
+    if (node_pool.GetChildren(_root_node)->number_of_children == 0)
+    {
+        // NOTE(david): the search was stopped before the first iteration, for example because the merged result of an ensemble was already decisive
+        Move move;
+        move.Invalidate();
+        return move;
+    }
+
+    TIMED_BLOCK(Node *best_node = SelectBestChild(_root_node, node_pool), JobNames::SelectBestChild);
+
+    return best_node->move_to_get_here;
+}
+
+void MCST::_SearchWorker(u32 worker_index, const TerminationPredicate &termination_predicate, const SimulateFromState &simulation_from_state, NodePool &node_pool, const GameState &game_state)
+{
+    SetRandomStream(_number_of_evaluations, _first_random_stream_index + worker_index);
 
     while (termination_predicate(false) == false)
     {
-        TIMED_BLOCK(SelectionResult selection_result = _Selection(legal_moveset_at_root_node, node_pool), JobNames::Selection);
+        unique_lock<mutex> tree_lock(_tree_mutex);
+
+        if (_root_node->terminal_type != TerminalType::NOT_TERMINAL)
+        {
+            // NOTE(david): if root node is a terminal node, it means that no more simulations are needed
+            // the lock is released first, as the predicate of an ensemble takes the locks of all its trees
+            tree_lock.unlock();
+            termination_predicate(true);
+            break ;
+        }
+
+        if (_evict_cold_subtrees && _root_node->num_simulations >= _next_eviction_num_simulations)
+        {
+            u32 failed_block_size = node_pool.FailedBlockSize();
+            if (failed_block_size > 0 || node_pool.CurrentAllocatedNodes() >= (u32)(eviction_high_watermark * node_pool.MaxNumberOfNodes()))
+            {
+                _EvictColdSubtrees(node_pool, failed_block_size);
+            }
+        }
+
+        TIMED_BLOCK(SelectionResult selection_result = _Selection(game_state, node_pool), JobNames::Selection);
+        if (selection_result.selected_node == nullptr)
+        {
+            // NOTE(david): the node pool ran out of nodes before the root could be expanded, there is nothing to search
+            tree_lock.unlock();
+            termination_predicate(true);
+            break ;
+        }
 
         SimulationResult simulation_result = {};
-        if (selection_result.selected_node->terminal_info.terminal_type != TerminalType::NOT_TERMINAL)
+        if (selection_result.selected_node->terminal_type != TerminalType::NOT_TERMINAL)
         {
             if (selection_result.selected_node == _root_node)
             {
                 // NOTE(david): if root node is a terminal node, it means that no more simulations are needed
+                tree_lock.unlock();
                 termination_predicate(true);
                 break ;
             }
 
             // TODO(david): these values should be set by some function by the user of MCST
-            switch (selection_result.selected_node->terminal_info.terminal_type)
+            switch (selection_result.selected_node->terminal_type)
             {
                 case TerminalType::WINNING: {
                     simulation_result.value = 1.0;
@@ -462,26 +1002,98 @@ Move MCST::Evaluate(const MoveSet &legal_moveset_at_root_node, TerminationPredic
         }
         else
         {
-            TIMED_BLOCK(simulation_result = simulation_from_state(selection_result.movesequence_from_position, game_state, selection_result.selected_node, node_pool), JobNames::Simulation);
+            Node *selected_node = selection_result.selected_node;
+            _AddVirtualLoss(selected_node, node_pool);
+            tree_lock.unlock();
+
+            TIMED_BLOCK(simulation_result = simulation_from_state(selection_result.leaf_game_state, game_state.player_to_move), JobNames::Simulation);
+
+            tree_lock.lock();
+            _RemoveVirtualLoss(selected_node, node_pool);
+            _ApplySimulationResult(selected_node, node_pool, simulation_result);
+            if (_root_node->terminal_type != TerminalType::NOT_TERMINAL)
+            {
+                // NOTE(david): another thread has solved the root in the meantime, keep the statistics on the path so that no node is left without a simulation, but there is nothing left to propagate
+                for (Node *cur_node = selected_node->parent; cur_node != nullptr; cur_node = cur_node->parent)
+                {
+                    AddStatistics(cur_node, node_pool, simulation_result.value, simulation_result.num_simulations);
+                }
+                continue ;
+            }
         }
         if (selection_result.selected_node->num_simulations > 10000000)
         {
-            DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, game_state);
+            DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, game_state, _debug_tree_id);
             assert(false && "suspicious amount of simulations, make sure this could happen");
         }
         TIMED_BLOCK(_BackPropagate(selection_result.selected_node, node_pool, simulation_result), JobNames::BackPropagate);
     }
 
-#if defined(DEBUG_WRITE_OUT)
-    DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, game_state);
-#endif
+    MERGE_THREAD_JOBS;
+}
 
-    TIMED_BLOCK(Node *best_node = SelectBestChild(_root_node, node_pool), JobNames::SelectBestChild);
+static r32 VirtualLossValue(Node *node)
+{
+    // NOTE(david): the virtual loss has to make the node look worse for the player that is selecting it
+    switch (node->controlled_type)
+    {
+        case ControlledType::CONTROLLED: {
+            return VIRTUAL_LOSS;
+        } break ;
+        case ControlledType::UNCONTROLLED: {
+            return -VIRTUAL_LOSS;
+        } break ;
+        default: {
+            UNREACHABLE_CODE;
+            return 0.0f;
+        }
+    }
+}
 
-    return best_node->move_to_get_here;
+void MCST::_AddVirtualLoss(Node *selected_node, NodePool &node_pool)
+{
+    for (Node *cur_node = selected_node; cur_node != nullptr; cur_node = cur_node->parent)
+    {
+        ++cur_node->num_virtual_losses;
+        AddStatistics(cur_node, node_pool, VirtualLossValue(cur_node), 1);
+    }
+}
+
+void MCST::_RemoveVirtualLoss(Node *selected_node, NodePool &node_pool)
+{
+    // ASSUMPTION(david): nodes with virtual losses are never pruned, so the path to the root is the same as when the virtual loss was added
+    for (Node *cur_node = selected_node; cur_node != nullptr; cur_node = cur_node->parent)
+    {
+        assert(cur_node->num_virtual_losses > 0 && cur_node->num_simulations > 0);
+        --cur_node->num_virtual_losses;
+        AddStatistics(cur_node, node_pool, -VirtualLossValue(cur_node), -1);
+    }
+}
+
+void MCST::_ApplySimulationResult(Node *simulated_node, NodePool &node_pool, SimulationResult simulation_result)
+{
+    AddStatistics(simulated_node, node_pool, simulation_result.value, simulation_result.num_simulations);
+
+    if (simulation_result.terminal_type != TerminalType::NOT_TERMINAL)
+    {
+        simulated_node->terminal_type = simulation_result.terminal_type;
+        switch (simulation_result.terminal_type)
+        {
+            case TerminalType::WINNING: {
+                node_pool.GetTerminalDepth(simulated_node)->winning = simulated_node->depth + simulation_result.plies_to_terminal;
+            } break ;
+            case TerminalType::LOSING: {
+                node_pool.GetTerminalDepth(simulated_node)->losing = simulated_node->depth + simulation_result.plies_to_terminal;
+            } break ;
+            case TerminalType::NEUTRAL: {
+                node_pool.GetTerminalDepth(simulated_node)->neutral = simulated_node->depth + simulation_result.plies_to_terminal;
+            } break ;
+            default: UNREACHABLE_CODE;
+        }
+    }
 }
 
-MCST::ExtremumChildren MCST::GetExtremumChildren(Node *from_node, NodePool &node_pool, u32 min_simulation_confidence_cycle_treshold)
+MCST::ExtremumChildren MCST::GetExtremumChildren(Node *from_node, NodePool &node_pool)
 {
     ExtremumChildren result = {};
 
@@ -498,57 +1110,57 @@ MCST::ExtremumChildren MCST::GetExtremumChildren(Node *from_node, NodePool &node
     r64 worst_neutral_uct;
 
     NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(from_node);
+    u32 parent_num_simulations = UCTParentNumSimulations(from_node, node_pool);
     for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
     {
-        Node *child_node = children_nodes->children[child_index];
-        assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
-
-        assert(child_node->num_simulations > 0 && "how is this child node chosen as a move but not simulated once?");
-        if (child_node->num_simulations < min_simulation_confidence_cycle_treshold)
+        Node *child_node = &children_nodes->children[child_index];
+        if (child_node->is_tombstone)
         {
-            // NOTE(david): needed for move cycling, above the treshold this node will be considered to be pruned for another move
             continue ;
         }
-        ++result.condition_checked_nodes_on_their_simulation_count;
+        assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
+
+        assert(child_node->num_simulations > 0 && "how is this child node chosen as a move but not simulated once?");
 
         // dispatch to fn calls from a rule table based on unique combination of controlled type and terminal type
-        r64 child_uct = UCT(child_node);
+        r64 child_uct = UCT(child_node, node_pool, parent_num_simulations);
         switch (from_node->controlled_type)
         {
             case ControlledType::CONTROLLED: {
-                switch (child_node->terminal_info.terminal_type)
+                switch (child_node->terminal_type)
                 {
                     case TerminalType::WINNING: {
-                        if (result.best_winning == nullptr || child_node->terminal_info.terminal_depth.winning < result.best_winning->terminal_info.terminal_depth.winning || (child_node->terminal_info.terminal_depth.winning == result.best_winning->terminal_info.terminal_depth.winning && child_uct > best_winning_uct))
+                        if (result.best_winning == nullptr || node_pool.GetTerminalDepth(child_node)->winning < node_pool.GetTerminalDepth(result.best_winning)->winning || (node_pool.GetTerminalDepth(child_node)->winning == node_pool.GetTerminalDepth(result.best_winning)->winning && child_uct > best_winning_uct))
                         {
                             result.best_winning = child_node;
                             best_winning_uct    = child_uct;
                         }
-                        if (result.worst_winning == nullptr || child_node->terminal_info.terminal_depth.winning > result.worst_winning->terminal_info.terminal_depth.winning || (child_node->terminal_info.terminal_depth.winning == result.worst_winning->terminal_info.terminal_depth.winning && child_uct < worst_winning_uct))
+                        if (result.worst_winning == nullptr || node_pool.GetTerminalDepth(child_node)->winning > node_pool.GetTerminalDepth(result.worst_winning)->winning || (node_pool.GetTerminalDepth(child_node)->winning == node_pool.GetTerminalDepth(result.worst_winning)->winning && child_uct < worst_winning_uct))
                         {
                             result.worst_winning = child_node;
                             worst_winning_uct    = child_uct;
                         }
                     } break ;
                     case TerminalType::LOSING: {
-                        if (result.best_losing == nullptr || child_node->terminal_info.terminal_depth.losing > result.best_losing->terminal_info.terminal_depth.losing || (child_node->terminal_info.terminal_depth.losing == result.best_losing->terminal_info.terminal_depth.losing && child_uct > best_losing_uct))
+                        if (result.best_losing == nullptr || node_pool.GetTerminalDepth(child_node)->losing > node_pool.GetTerminalDepth(result.best_losing)->losing || (node_pool.GetTerminalDepth(child_node)->losing == node_pool.GetTerminalDepth(result.best_losing)->losing && child_uct > best_losing_uct))
                         {
                             result.best_losing = child_node;
                             best_losing_uct    = child_uct;
                         }
-                        if (result.worst_losing == nullptr || child_node->terminal_info.terminal_depth.losing < result.worst_losing->terminal_info.terminal_depth.losing || (child_node->terminal_info.terminal_depth.losing == result.worst_losing->terminal_info.terminal_depth.losing && child_uct < worst_losing_uct))
+                        if (result.worst_losing == nullptr || node_pool.GetTerminalDepth(child_node)->losing < node_pool.GetTerminalDepth(result.worst_losing)->losing || (node_pool.GetTerminalDepth(child_node)->losing == node_pool.GetTerminalDepth(result.worst_losing)->losing && child_uct < worst_losing_uct))
                         {
                             result.worst_losing = child_node;
                             worst_losing_uct    = child_uct;
                         }
                     } break ;
                     case TerminalType::NEUTRAL: {
-                        if (result.best_neutral == nullptr || child_node->terminal_info.terminal_depth.neutral > result.best_neutral->terminal_info.terminal_depth.neutral || (child_node->terminal_info.terminal_depth.neutral == result.best_neutral->terminal_info.terminal_depth.neutral && child_uct > best_neutral_uct))
+                        // NOTE(david): the neutral depth of a solved draw is only an upper bound, so the draws are told apart by their uct only
+                        if (result.best_neutral == nullptr || child_uct > best_neutral_uct)
                         {
                             result.best_neutral = child_node;
                             best_neutral_uct    = child_uct;
                         }
-                        if (result.worst_neutral == nullptr || child_node->terminal_info.terminal_depth.neutral < result.worst_neutral->terminal_info.terminal_depth.neutral || (child_node->terminal_info.terminal_depth.neutral == result.worst_neutral->terminal_info.terminal_depth.neutral && child_uct < worst_neutral_uct))
+                        if (result.worst_neutral == nullptr || child_uct < worst_neutral_uct)
                         {
                             result.worst_neutral = child_node;
                             worst_neutral_uct    = child_uct;
@@ -570,39 +1182,39 @@ MCST::ExtremumChildren MCST::GetExtremumChildren(Node *from_node, NodePool &node
                 }
             } break ;
             case ControlledType::UNCONTROLLED: {
-                switch (child_node->terminal_info.terminal_type)
+                switch (child_node->terminal_type)
                 {
                     case TerminalType::WINNING: {
-                        if (result.best_winning == nullptr || child_node->terminal_info.terminal_depth.winning > result.best_winning->terminal_info.terminal_depth.winning || (child_node->terminal_info.terminal_depth.winning == result.best_winning->terminal_info.terminal_depth.winning && child_uct > best_winning_uct))
+                        if (result.best_winning == nullptr || node_pool.GetTerminalDepth(child_node)->winning > node_pool.GetTerminalDepth(result.best_winning)->winning || (node_pool.GetTerminalDepth(child_node)->winning == node_pool.GetTerminalDepth(result.best_winning)->winning && child_uct > best_winning_uct))
                         {
                             result.best_winning = child_node;
                             best_winning_uct    = child_uct;
                         }
-                        if (result.worst_winning == nullptr || child_node->terminal_info.terminal_depth.winning < result.worst_winning->terminal_info.terminal_depth.winning || (child_node->terminal_info.terminal_depth.winning == result.worst_winning->terminal_info.terminal_depth.winning && child_uct < worst_winning_uct))
+                        if (result.worst_winning == nullptr || node_pool.GetTerminalDepth(child_node)->winning < node_pool.GetTerminalDepth(result.worst_winning)->winning || (node_pool.GetTerminalDepth(child_node)->winning == node_pool.GetTerminalDepth(result.worst_winning)->winning && child_uct < worst_winning_uct))
                         {
                             result.worst_winning = child_node;
                             worst_winning_uct    = child_uct;
                         }
                     } break ;
                     case TerminalType::LOSING: {
-                        if (result.best_losing == nullptr || child_node->terminal_info.terminal_depth.losing < result.best_losing->terminal_info.terminal_depth.losing || (child_node->terminal_info.terminal_depth.losing == result.best_losing->terminal_info.terminal_depth.losing && child_uct > best_losing_uct))
+                        if (result.best_losing == nullptr || node_pool.GetTerminalDepth(child_node)->losing < node_pool.GetTerminalDepth(result.best_losing)->losing || (node_pool.GetTerminalDepth(child_node)->losing == node_pool.GetTerminalDepth(result.best_losing)->losing && child_uct > best_losing_uct))
                         {
                             result.best_losing = child_node;
                             best_losing_uct    = child_uct;
                         }
-                        if (result.worst_losing == nullptr || child_node->terminal_info.terminal_depth.losing > result.worst_losing->terminal_info.terminal_depth.losing || (child_node->terminal_info.terminal_depth.losing == result.worst_losing->terminal_info.terminal_depth.losing && child_uct < worst_losing_uct))
+                        if (result.worst_losing == nullptr || node_pool.GetTerminalDepth(child_node)->losing > node_pool.GetTerminalDepth(result.worst_losing)->losing || (node_pool.GetTerminalDepth(child_node)->losing == node_pool.GetTerminalDepth(result.worst_losing)->losing && child_uct < worst_losing_uct))
                         {
                             result.worst_losing = child_node;
                             worst_losing_uct    = child_uct;
                         }
                     } break ;
                     case TerminalType::NEUTRAL: {
-                        if (result.best_neutral == nullptr || child_node->terminal_info.terminal_depth.neutral > result.best_neutral->terminal_info.terminal_depth.neutral || (child_node->terminal_info.terminal_depth.neutral == result.best_neutral->terminal_info.terminal_depth.neutral && child_uct > best_neutral_uct))
+                        if (result.best_neutral == nullptr || child_uct > best_neutral_uct)
                         {
                             result.best_neutral = child_node;
                             best_neutral_uct    = child_uct;
                         }
-                        if (result.worst_neutral == nullptr || child_node->terminal_info.terminal_depth.neutral < result.worst_neutral->terminal_info.terminal_depth.neutral || (child_node->terminal_info.terminal_depth.neutral == result.worst_neutral->terminal_info.terminal_depth.neutral && child_uct < worst_neutral_uct))
+                        if (result.worst_neutral == nullptr || child_uct < worst_neutral_uct)
                         {
                             result.worst_neutral = child_node;
                             worst_neutral_uct    = child_uct;
@@ -627,28 +1239,28 @@ MCST::ExtremumChildren MCST::GetExtremumChildren(Node *from_node, NodePool &node
         }
     }
 
-    assert(result.best_winning == nullptr || result.best_winning->terminal_info.terminal_type == TerminalType::WINNING);
-    assert(result.worst_winning == nullptr || result.worst_winning->terminal_info.terminal_type == TerminalType::WINNING);
+    assert(result.best_winning == nullptr || result.best_winning->terminal_type == TerminalType::WINNING);
+    assert(result.worst_winning == nullptr || result.worst_winning->terminal_type == TerminalType::WINNING);
     assert((result.best_winning == nullptr && result.worst_winning == nullptr) || (result.best_winning != nullptr && result.worst_winning != nullptr));
    
-    assert(result.best_losing == nullptr || result.best_losing->terminal_info.terminal_type == TerminalType::LOSING);
-    assert(result.worst_losing == nullptr || result.worst_losing->terminal_info.terminal_type == TerminalType::LOSING);
+    assert(result.best_losing == nullptr || result.best_losing->terminal_type == TerminalType::LOSING);
+    assert(result.worst_losing == nullptr || result.worst_losing->terminal_type == TerminalType::LOSING);
     assert((result.best_losing == nullptr && result.worst_losing == nullptr) || (result.best_losing != nullptr && result.worst_losing != nullptr));
 
-    assert(result.best_neutral == nullptr || result.best_neutral->terminal_info.terminal_type == TerminalType::NEUTRAL);
-    assert(result.worst_neutral == nullptr || result.worst_neutral->terminal_info.terminal_type == TerminalType::NEUTRAL);
+    assert(result.best_neutral == nullptr || result.best_neutral->terminal_type == TerminalType::NEUTRAL);
+    assert(result.worst_neutral == nullptr || result.worst_neutral->terminal_type == TerminalType::NEUTRAL);
     assert((result.best_neutral == nullptr && result.worst_neutral == nullptr) || (result.best_neutral != nullptr && result.worst_neutral != nullptr));
     
-    assert(result.best_non_terminal == nullptr || result.best_non_terminal->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-    assert(result.worst_non_terminal == nullptr || result.worst_non_terminal->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
+    assert(result.best_non_terminal == nullptr || result.best_non_terminal->terminal_type == TerminalType::NOT_TERMINAL);
+    assert(result.worst_non_terminal == nullptr || result.worst_non_terminal->terminal_type == TerminalType::NOT_TERMINAL);
     assert((result.best_non_terminal == nullptr && result.worst_non_terminal == nullptr) || (result.best_non_terminal != nullptr && result.worst_non_terminal != nullptr));
 
     return result;
 }
 
-Node *MCST::_SelectChild(Node *from_node, const MoveSet &legal_moves_from_node, bool focus_on_lowest_utc_to_prune, NodePool &node_pool)
+Node *MCST::_SelectChild(Node *from_node, const GameState &game_state_at_node, bool focus_on_lowest_utc_to_prune, NodePool &node_pool)
 {
-    assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL && "if from_node was terminal, we wouldn't need to select its child for the next move");
+    assert(from_node->terminal_type == TerminalType::NOT_TERMINAL && "if from_node was terminal, we wouldn't need to select its child for the next move");
 
     Node *selected_node = nullptr;
 
@@ -660,9 +1272,9 @@ Node *MCST::_SelectChild(Node *from_node, const MoveSet &legal_moves_from_node,
             if (extremum_children.best_winning != nullptr)
             {
                 // TODO(david): not only do these always belong together, but also when a node's terminality is set, might as well prune all its children? Sounds expensive, but probably worth it as it reduces the size of the tree
-                assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                from_node->terminal_info.terminal_type = TerminalType::WINNING;
-                // from_node->terminal_info.terminal_depth.winning = from_node->depth;
+                assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                from_node->terminal_type = TerminalType::WINNING;
+                // node_pool.GetTerminalDepth(from_node)->winning = from_node->depth;
                 extremum_children.best_winning->UpdateTerminalDepthForParentNode(TerminalType::WINNING, node_pool);
 
                 // TODO(david): prune children of from_node?
@@ -673,9 +1285,9 @@ Node *MCST::_SelectChild(Node *from_node, const MoveSet &legal_moves_from_node,
         case ControlledType::UNCONTROLLED: {
             if (extremum_children.best_losing != nullptr)
             {
-                assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                from_node->terminal_info.terminal_type = TerminalType::LOSING;
-                // from_node->terminal_info.terminal_depth.losing = from_node->depth;
+                assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                from_node->terminal_type = TerminalType::LOSING;
+                // node_pool.GetTerminalDepth(from_node)->losing = from_node->depth;
                 extremum_children.best_losing->UpdateTerminalDepthForParentNode(TerminalType::LOSING, node_pool);
 
                 // TODO(david): prune children of from_node?
@@ -686,378 +1298,113 @@ Node *MCST::_SelectChild(Node *from_node, const MoveSet &legal_moves_from_node,
         default: UNREACHABLE_CODE;
     }
 
-    MoveSet cur_legal_moves_from_node = legal_moves_from_node;
     NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(from_node);
-    for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+    const MoveSet &legal_moves_from_node = game_state_at_node.legal_moveset;
+    // NOTE(david): every expanded child (including the pruned ones) took one of the legal moves in the order of their move indices, so there are still unexpanded moves if there are less children than legal moves
+    u32 number_of_legal_moves = legal_moves_from_node.NumberOfMoves();
+    bool check_for_new_moves = children_nodes->number_of_children < number_of_legal_moves;
+    // ASSUMPTION(david): if there was either a losing choice for an uncontrolled node or a winning choice for a controlled node, we should have already returned at this point
+    // TODO(david): think about if there is at least one neutral node, it shouldn't necessarily be selected, as there hasn't been all moves explored yet
+    if (check_for_new_moves == true)
     {
-        Node *child_node = children_nodes->children[child_index];
-        assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
+        // NOTE(david): get the lower bound move from the set of legal moves
+        Move selected_move = legal_moves_from_node.GetFirstMoveFrom((u32)(children_nodes->highest_move_index + 1));
+        assert(selected_move.IsValid() && "there has to be a legal move after the highest expanded one");
 
-        cur_legal_moves_from_node.DeleteMove(child_node->move_to_get_here);
+        selected_node = _Expansion(from_node, selected_move, number_of_legal_moves, game_state_at_node.ZobristHashAfterMove(selected_move), node_pool);
+        if (selected_node == nullptr)
+        {
+            // NOTE(david): the node pool is out of nodes, continue with the best expanded child that isn't decided yet, if there isn't one, the selection has to stop at from_node
+            return extremum_children.best_non_terminal;
+        }
     }
 
-    // NOTE(david): there are still possible moves from the move set
-    bool check_for_new_moves = cur_legal_moves_from_node.moves_left > 0;
-    // ASSUMPTION(david): if there was either a losing choice for an uncontrolled node or a winning choice for a controlled node, we should have already returned at this point
-    // TODO(david): think about if there is at least one neutral node, it shouldn't necessarily be selected, as there hasn't been all moves explored yet
-    // neutral_controlled_node == nullptr && neutral_uncontrolled_node == nullptr && 
-    if (check_for_new_moves == true)
+    // NOTE(david): no move has been selected yet, choose the best amongst the best children
+    if (selected_node == nullptr)
     {
-        i32 highest_move_index = children_nodes->highest_move_index;
-        i32 lower_bound_move_index = -1;
-        // NOTE(david): get the lower bound move index from the set of legal moves
-        for (u32 move_index = 0; move_index < ArrayCount(cur_legal_moves_from_node.moves); ++move_index)
+        switch (from_node->controlled_type)
         {
-            // TODO(david): implement iterator for the MoveSet
-            Move cur_move = cur_legal_moves_from_node.moves[move_index];
-            if (cur_move.IsValid() == false)
-            {
-                continue ;
-            }
-            if (highest_move_index == -1 || move_index > highest_move_index)
-            {
-                // NOTE(david): if haven't chosen a move before or the current move is higher by order
-                if (lower_bound_move_index == -1 || move_index < lower_bound_move_index)
+            case ControlledType::CONTROLLED: {
+                if (extremum_children.best_neutral != nullptr && extremum_children.best_non_terminal == nullptr)
                 {
-                    lower_bound_move_index = move_index;
+                    assert(extremum_children.best_winning == nullptr && "this should have been selected already");
+                    // TODO(david): rethink this assumption, especially when transposition tables are introduced
+                    // ASSUMPTION(david): if there is only terminal moves, that means there are no more moves to expand, so mark from_node as neutral, update neutral terminal depth potentially
+                    assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                    from_node->terminal_type = TerminalType::NEUTRAL;
+                    // node_pool.GetTerminalDepth(from_node)->neutral = from_node->depth;
+                    extremum_children.best_neutral->UpdateTerminalDepthForParentNode(TerminalType::NEUTRAL, node_pool);
+
+                    // TODO(david): prune from_node's children
+
+                    selected_node = from_node;
                 }
-            }
-        }
-        if (lower_bound_move_index != -1)
-        {
-            // NOTE(david): found a move to be explored from the set
+                else if (extremum_children.best_non_terminal != nullptr)
+                {
+                    selected_node = extremum_children.best_non_terminal;
+                }
+                else if (extremum_children.best_losing != nullptr)
+                {
+                    // NOTE(david): only losing moves are available -> mark controlled node as losing, update losing terminal depth potentially
+                    assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                    from_node->terminal_type = TerminalType::LOSING;
+                    // node_pool.GetTerminalDepth(from_node)->losing = from_node->depth;
+                    extremum_children.best_losing->UpdateTerminalDepthForParentNode(TerminalType::LOSING, node_pool);
 
-            assert(lower_bound_move_index >= 0 && lower_bound_move_index < ArrayCount(cur_legal_moves_from_node.moves));
-            Move selected_move = cur_legal_moves_from_node.moves[lower_bound_move_index];
-            assert(selected_move.IsValid());
+                    // TODO(david): prune from_node's children
 
-            if (children_nodes->number_of_children >= ArrayCount(NodePool::ChildrenTables::children))
-            {
-                // NOTE(david): need to cycle moves as there aren't any slots available
+                    selected_node = from_node;
+                }
+                else
+                {
+                    // NOTE(david): all children nodes are pruned out -> mark controlled node as losing, update its terminal depth
+                    assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                    from_node->terminal_type = TerminalType::LOSING;
+                    node_pool.GetTerminalDepth(from_node)->losing = from_node->depth + 1;
+                    
+                    // TODO(david): prune from_node's children
+
+                    selected_node = from_node;
+                }
+            } break ;
+            case ControlledType::UNCONTROLLED: {
+                if (extremum_children.best_neutral != nullptr && extremum_children.best_non_terminal == nullptr)
+                {
+                    assert(extremum_children.best_losing == nullptr && "this should have been selected already");
+                    // TODO(david): rethink this assumption, especially when transposition tables are introduced
+                    // ASSUMPTION(david): if there is only terminal moves, that means there are no more moves to expand, so mark from_node as neutral, update its neutral terminal depth potentially
+                    assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                    from_node->terminal_type = TerminalType::NEUTRAL;
+                    // node_pool.GetTerminalDepth(from_node)->neutral = from_node->depth;
+                    extremum_children.best_neutral->UpdateTerminalDepthForParentNode(TerminalType::NEUTRAL, node_pool);
+
+                    // TODO(david): prune from_node's children
 
-                if (extremum_children.best_non_terminal == nullptr)
+                    selected_node = from_node;
+                }
+                else if (extremum_children.best_non_terminal != nullptr)
                 {
-                    // NOTE(david): we only have terminal nodes that doesn't favor either side here, so prune one of the children (the worst one) and then expand with the new move
-                    if (from_node->controlled_type == ControlledType::CONTROLLED)
-                    {
-                        if (extremum_children.worst_losing)
-                        {
-                            if (extremum_children.worst_losing == extremum_children.best_losing)
-                            {
-                                extremum_children.best_losing = nullptr;
-                            }
-                            PruneNode(extremum_children.worst_losing, node_pool);
-                            extremum_children.worst_losing = nullptr;
-                        }
-                        else if (extremum_children.worst_neutral)
-                        {
-                            if (extremum_children.worst_neutral == extremum_children.best_neutral)
-                            {
-                                extremum_children.best_neutral = nullptr;
-                            }
-                            PruneNode(extremum_children.worst_neutral, node_pool);
-                            extremum_children.worst_neutral = nullptr;
-                        }
-                        else
-                        {
-                            UNREACHABLE_CODE;
-                        }
-                    }
-                    else if (from_node->controlled_type == ControlledType::UNCONTROLLED)
-                    {
-                        if (extremum_children.worst_winning)
-                        {
-                            if (extremum_children.worst_winning == extremum_children.best_winning)
-                            {
-                                extremum_children.best_winning = nullptr;
-                            }
-                            PruneNode(extremum_children.worst_winning, node_pool);
-                            extremum_children.worst_winning = nullptr;
-                        }
-                        else if (extremum_children.worst_neutral)
-                        {
-                            if (extremum_children.worst_neutral == extremum_children.best_neutral)
-                            {
-                                extremum_children.best_neutral = nullptr;
-                            }
-                            PruneNode(extremum_children.worst_neutral, node_pool);
-                            extremum_children.worst_neutral = nullptr;
-                        }
-                        else
-                        {
-                            UNREACHABLE_CODE;
-                        }
-                    }
-                    else
-                    {
-                        UNREACHABLE_CODE;
-                    }
+                    selected_node = extremum_children.best_non_terminal;
+                }
+                else if (extremum_children.best_winning != nullptr)
+                {
+                    // NOTE(david): all moves are winning -> mark uncontrolled node as winning, update its winning terminal depth potentially
+                    assert(from_node->terminal_type == TerminalType::NOT_TERMINAL);
+                    from_node->terminal_type = TerminalType::WINNING;
+                    // node_pool.GetTerminalDepth(from_node)->winning = from_node->depth;
+                    extremum_children.best_winning->UpdateTerminalDepthForParentNode(TerminalType::WINNING, node_pool);
+
+                    // TODO(david): prune from_node's children
 
-                    assert(children_nodes->number_of_children < ArrayCount(NodePool::ChildrenTables::children));
-                    selected_node = _Expansion(from_node, node_pool);
-                    node_pool.AddChild(from_node, selected_node, selected_move);
+                    selected_node = from_node;
                 }
                 else
                 {
-                    // NOTE(david): already have a selected move.. since we have a limited action space to simulate at a given time, it makes sense to keep the currently selected nodes, however, if there is a bad move, we can replace it with a new one
-                    // NOTE(david): optimally we would also like to explore all the possibilities to a certain depth in order to determine if there are nearby terminal moves, how to do this? One approach that comes to mind is that after certain amounts of simulations, we could prune nodes further, the idea behind this is if that node is not terminal yet (which it isn't at this point) and if the mean value is below a treshold, then we could assume, that the node is not worth exploring further with a high confidence, so prune the node and choose a new move.. we could arrive at a state where we pruned all children, which should already be taken care of. What should the number of simulations be, where we are certain enough that the node can be condition checked to prune? Also what happens, when none of the nodes meet the condition check? Then all the children slots are taken by nodes which are okayish moves.. but we would still not know if there is a terminal moves from the unexplored ones.. so then we would want to prune the worse out of all the promising moves in order to explore further new ones, as there is no benefit in keeping the worst, as we'd just choose the best anyway.
-                    Node *node_to_prune = nullptr;
+                    // NOTE(david): all children nodes are pruned out -> mark uncontrolled node as winning as there are no good moves for uncontrolled, update its winning terminal depth
+                    from_node->terminal_type = TerminalType::WINNING;
+                    node_pool.GetTerminalDepth(from_node)->winning = from_node->depth + 1;
 
-                    switch (from_node->controlled_type)
-                    {
-                        case ControlledType::CONTROLLED: {
-                            if (extremum_children.worst_losing)
-                            {
-                                node_to_prune = extremum_children.worst_losing;
-                            }
-                        } break ;
-                        case ControlledType::UNCONTROLLED: {
-                            if (extremum_children.worst_winning)
-                            {
-                                node_to_prune = extremum_children.worst_winning;
-                            }
-                        } break ;
-                        default: UNREACHABLE_CODE;
-                    }
-
-                    // TODO(david): similar logic exists in backpropagation, maybe store them in a central place?
-                    // TODO(david): this number needs to decrease each depth by a factor of how many children slots there can be at a given time so that each child can contribute the same amount of simulations
-                    // TODO(david): Think about this more as there is a problem that the min simulation number approaches 0. Maybe introduce a minimum simulation count.
-                    // TODO(david): the number of simulations treshold should maybe be a dynamic parameter depending on how much time is allowed to think, actually thinking about this more, isn't the upper limit the expected number of simulations from root?
-                    // IMPORTANT(david): the sum of children's num sim treshold needs to be above the parent's num sim treshold, otherwise the sum of children's simulations will never reach the parent's, resulting in no pruning and no move cycling as a result
-                    assert(ArrayCount(NodePool::ChildrenTables::children) > 1);
-                    r64 branching_factor = pow(ArrayCount(NodePool::ChildrenTables::children) - 1, from_node->depth + 1);
-                    // NOTE(david): so that in case of high branching, the move won't be immediately cycled in case the min treshold approached 0
-                    constexpr u32 min_simulations_for_move = 25;
-                    // TODO(david): maybe this number should be a power of ArrayCount(NodePool::ChildrenTables::children) to have know at which depth the treshold approaches to 0 -> allowed time / time it takes to complete 1 evaluation
-                    constexpr u32 min_simulations_from_root = 4096;
-                    u32 min_simulation_confidence_cycle_treshold = (u32)(min_simulations_from_root / branching_factor) + min_simulations_for_move;
-                    // NOTE(david): two tresholds for controlled/uncontrolled, force nodes to be terminal outside this interval
-                    constexpr r64 min_mean_value_treshold = -0.95;
-                    constexpr r64 max_mean_value_treshold = 0.95;
-
-# if 0
-                    for (u32 child_index = 0; child_index < children_nodes->number_of_children && node_to_prune == nullptr; ++child_index)
-                    {
-                        Node *child_node = children_nodes->children[child_index];
-                        if (child_node->num_simulations >= min_simulation_confidence_cycle_treshold)
-                        {
-                            r64 child_mean_value = child_node->value / (r64)child_node->num_simulations;
-                            switch (from_node->controlled_type)
-                            {
-                                case ControlledType::CONTROLLED: {
-                                    if (child_mean_value <= min_mean_value_treshold)
-                                    {
-                                        assert(false);
-                                        node_to_prune = child_node;
-                                    }
-                                } break ;
-                                case ControlledType::UNCONTROLLED: {
-                                    if (child_mean_value >= max_mean_value_treshold)
-                                    {
-                                        node_to_prune = child_node;
-                                    }
-                                } break ;
-                                default: UNREACHABLE_CODE;
-                            }
-                        }
-                    }
-#endif
-                    if (node_to_prune == nullptr)
-                    {
-                        // NOTE(david): none of the moves are terminal and none of them falls outside the mean value with enough simulations
-                        ExtremumChildren extremum_children_for_cycleing = GetExtremumChildren(from_node, node_pool, min_simulation_confidence_cycle_treshold);
-                        // NOTE(david): if there is only 1 condition checked node that have enough simulations, don't prune it yet, as it's our current best node
-                        if (extremum_children_for_cycleing.condition_checked_nodes_on_their_simulation_count > 1)
-                        {
-                            switch (from_node->controlled_type)
-                            {
-                                case ControlledType::CONTROLLED: {
-                                    if (extremum_children_for_cycleing.worst_losing)
-                                    {
-                                        assert(false && "should already have been selected");
-                                    }
-                                    else if (extremum_children_for_cycleing.worst_non_terminal)
-                                    {
-                                        node_to_prune = extremum_children_for_cycleing.worst_non_terminal;
-                                    }
-                                    else if (extremum_children_for_cycleing.worst_neutral)
-                                    {
-                                        node_to_prune = extremum_children_for_cycleing.worst_neutral;
-                                    }
-                                    else
-                                    {
-                                        assert(false && "if there is a winning move for controlled node, we already should have selected it");
-                                    }
-                                } break ;
-                                case ControlledType::UNCONTROLLED: {
-                                    if (extremum_children_for_cycleing.worst_winning)
-                                    {
-                                        assert(false && "should already have been selected");
-                                    }
-                                    else if (extremum_children_for_cycleing.worst_non_terminal)
-                                    {
-                                        node_to_prune = extremum_children_for_cycleing.worst_non_terminal;
-                                    }
-                                    else if (extremum_children_for_cycleing.worst_neutral)
-                                    {
-                                        node_to_prune = extremum_children_for_cycleing.worst_neutral;
-                                    }
-                                    else
-                                    {
-                                        assert(false && "if there is a losing move for uncontrolled node, we already should have selected it");
-                                    }
-                                } break ;
-                                default: UNREACHABLE_CODE;
-                            }
-                        }
-                    }
-
-                    if (node_to_prune != nullptr)
-                    {
-                        if (node_to_prune == extremum_children.worst_winning)
-                        {
-                            if (extremum_children.worst_winning == extremum_children.best_winning)
-                            {
-                                extremum_children.best_winning = nullptr;
-                            }
-                            extremum_children.best_winning = nullptr;
-                        }
-                        else if (node_to_prune == extremum_children.worst_losing)
-                        {
-                            if (extremum_children.worst_losing == extremum_children.worst_losing)
-                            {
-                                extremum_children.worst_losing = nullptr;
-                            }
-                            extremum_children.worst_losing = nullptr;
-                        }
-                        else if (node_to_prune == extremum_children.worst_neutral)
-                        {
-                            if (extremum_children.worst_neutral == extremum_children.best_neutral)
-                            {
-                                extremum_children.best_neutral = nullptr;
-                            }
-                            extremum_children.worst_neutral = nullptr;
-                        }
-                        else if (node_to_prune == extremum_children.worst_non_terminal)
-                        {
-                            if (extremum_children.worst_non_terminal == extremum_children.best_non_terminal)
-                            {
-                                extremum_children.best_non_terminal = nullptr;
-                            }
-                            extremum_children.worst_non_terminal = nullptr;
-                        }
-                        // NOTE(david): if either one of the moves is terminally bad or all the nodes are non-terminal and either we have a node that falls outside of the mean value interval or none of them falls outside, in which case the one with the worst mean is selected
-                        PruneNode(node_to_prune, node_pool);
-                        selected_node = _Expansion(from_node, node_pool);
-                        node_pool.AddChild(from_node, selected_node, selected_move);
-                    }
-                    else
-                    {
-                        // NOTE(david): none of the children are terminally bad and none of them have enough simulations to determine what to prune
-                    }
-                }
-            }
-            else
-            {
-                // NOTE(david): can safely expand as there are available children slots
-                selected_node = _Expansion(from_node, node_pool);
-                node_pool.AddChild(from_node, selected_node, selected_move);
-            }
-        }
-        else
-        {
-            // NOTE(david): none of the legal moves serialized are higher than the current highest serialized move stored in the child_table -> we don't have a new move
-            // TODO(david): when transposition table is introduced, this will not yet be the case
-        }
-    }
-
-    // NOTE(david): no move has been selected yet, choose the best amongst the best children
-    if (selected_node == nullptr)
-    {
-        switch (from_node->controlled_type)
-        {
-            case ControlledType::CONTROLLED: {
-                if (extremum_children.best_neutral != nullptr && extremum_children.best_non_terminal == nullptr)
-                {
-                    assert(extremum_children.best_winning == nullptr && "this should have been selected already");
-                    // TODO(david): rethink this assumption, especially when transposition tables are introduced
-                    // ASSUMPTION(david): if there is only terminal moves, that means there are no more moves to cycle, so mark from_node as neutral, update neutral terminal depth potentially
-                    assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                    from_node->terminal_info.terminal_type = TerminalType::NEUTRAL;
-                    // from_node->terminal_info.terminal_depth.neutral = from_node->depth;
-                    extremum_children.best_neutral->UpdateTerminalDepthForParentNode(TerminalType::NEUTRAL, node_pool);
-
-                    // TODO(david): prune from_node's children
-
-                    selected_node = from_node;
-                }
-                else if (extremum_children.best_non_terminal != nullptr)
-                {
-                    selected_node = extremum_children.best_non_terminal;
-                }
-                else if (extremum_children.best_losing != nullptr)
-                {
-                    // NOTE(david): only losing moves are available -> mark controlled node as losing, update losing terminal depth potentially
-                    assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                    from_node->terminal_info.terminal_type = TerminalType::LOSING;
-                    // from_node->terminal_info.terminal_depth.losing = from_node->depth;
-                    extremum_children.best_losing->UpdateTerminalDepthForParentNode(TerminalType::LOSING, node_pool);
-
-                    // TODO(david): prune from_node's children
-
-                    selected_node = from_node;
-                }
-                else
-                {
-                    // NOTE(david): all children nodes are pruned out -> mark controlled node as losing, update its terminal depth
-                    assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                    from_node->terminal_info.terminal_type = TerminalType::LOSING;
-                    from_node->terminal_info.terminal_depth.losing = from_node->depth + 1;
-                    
-                    // TODO(david): prune from_node's children
-
-                    selected_node = from_node;
-                }
-            } break ;
-            case ControlledType::UNCONTROLLED: {
-                if (extremum_children.best_neutral != nullptr && extremum_children.best_non_terminal == nullptr)
-                {
-                    assert(extremum_children.best_losing == nullptr && "this should have been selected already");
-                    // TODO(david): rethink this assumption, especially when transposition tables are introduced
-                    // ASSUMPTION(david): if there is only terminal moves, that means there are no more moves to cycle, so mark from_node as neutral, update its neutral terminal depth potentially
-                    assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                    from_node->terminal_info.terminal_type = TerminalType::NEUTRAL;
-                    // from_node->terminal_info.terminal_depth.neutral = from_node->depth;
-                    extremum_children.best_neutral->UpdateTerminalDepthForParentNode(TerminalType::NEUTRAL, node_pool);
-
-                    // TODO(david): prune from_node's children
-
-                    selected_node = from_node;
-                }
-                else if (extremum_children.best_non_terminal != nullptr)
-                {
-                    selected_node = extremum_children.best_non_terminal;
-                }
-                else if (extremum_children.best_winning != nullptr)
-                {
-                    // NOTE(david): all moves are winning -> mark uncontrolled node as winning, update its winning terminal depth potentially
-                    assert(from_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
-                    from_node->terminal_info.terminal_type = TerminalType::WINNING;
-                    // from_node->terminal_info.terminal_depth.winning = from_node->depth;
-                    extremum_children.best_winning->UpdateTerminalDepthForParentNode(TerminalType::WINNING, node_pool);
-
-                    // TODO(david): prune from_node's children
-
-                    selected_node = from_node;
-                }
-                else
-                {
-                    // NOTE(david): all children nodes are pruned out -> mark uncontrolled node as winning as there are no good moves for uncontrolled, update its winning terminal depth
-                    from_node->terminal_info.terminal_type = TerminalType::WINNING;
-                    from_node->terminal_info.terminal_depth.winning = from_node->depth + 1;
-
-                    // TODO(david): prune from_node's children
+                    // TODO(david): prune from_node's children
 
                     selected_node = from_node;
                 }
@@ -1071,13 +1418,12 @@ Node *MCST::_SelectChild(Node *from_node, const MoveSet &legal_moves_from_node,
     return selected_node;
 }
 
-// TODO(david): use transposition table to speed up the selection, which would store previous searches, allowing to avoid re-exploring parts of the tree that have already been searched
-// TODO(david): LRU?
-MCST::SelectionResult MCST::_Selection(const MoveSet &legal_moveset_at_root_node, NodePool &node_pool)
+MCST::SelectionResult MCST::_Selection(const GameState &game_state, NodePool &node_pool)
 {
     SelectionResult selection_result = {};
+    selection_result.leaf_game_state = game_state;
 
-    if (_root_node->terminal_info.terminal_type != TerminalType::NOT_TERMINAL)
+    if (_root_node->terminal_type != TerminalType::NOT_TERMINAL)
     {
         selection_result.selected_node = _root_node;
 
@@ -1085,24 +1431,30 @@ MCST::SelectionResult MCST::_Selection(const MoveSet &legal_moveset_at_root_node
     }
 
     Node *current_node = _root_node;
-    MoveSet current_legal_moves = legal_moveset_at_root_node;
+    const GameState &current_game_state = selection_result.leaf_game_state;
     // TODO(david): move depth into the node as it makes sense when calculating the best next move to return from Evaluate
     // bool focus_on_lowest_utc_to_prune = GetRandomNumber(0, 10) < 0;
     bool focus_on_lowest_utc_to_prune = false;
     while (1)
     {
-        if (current_legal_moves.moves_left == 0)
+        if (current_game_state.legal_moveset.NumberOfMoves() == 0)
         {
             // NOTE(david): all moves are exhausted, reached terminal node
             break;
         }
 
-        assert(current_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL && "if current node is a terminal type, we must have returned it already after _SelectChild");
+        assert(current_node->terminal_type == TerminalType::NOT_TERMINAL && "if current node is a terminal type, we must have returned it already after _SelectChild");
         // NOTE(david): Select a child node and its corresponding legal move based on maximum UCT value and some other heuristic
-        Node *selected_child_node = _SelectChild(current_node, current_legal_moves, focus_on_lowest_utc_to_prune, node_pool);
-        assert(selected_child_node != nullptr);
+        Node *selected_child_node = _SelectChild(current_node, current_game_state, focus_on_lowest_utc_to_prune, node_pool);
+        if (selected_child_node == nullptr)
+        {
+            // NOTE(david): the node pool is out of nodes, so simulate from the current node again instead of expanding it, the failed allocation is recorded by the pool for the next eviction pass
+            selection_result.selected_node = current_node == _root_node ? nullptr : current_node;
+
+            return selection_result;
+        }
 
-        if (selected_child_node->terminal_info.terminal_type != TerminalType::NOT_TERMINAL)
+        if (selected_child_node->terminal_type != TerminalType::NOT_TERMINAL)
         {
             selection_result.selected_node = selected_child_node;
 
@@ -1113,27 +1465,30 @@ MCST::SelectionResult MCST::_Selection(const MoveSet &legal_moveset_at_root_node
         }
 
         selection_result.selected_node = selected_child_node;
-        selection_result.movesequence_from_position.AddMove(selected_child_node->move_to_get_here);
-        // NOTE(david): the selected child is an unexplored one
-        if (selected_child_node->num_simulations == 0)
+        assert(selection_result.leaf_game_state.outcome_for_previous_player == GameOutcome::NONE && "the game ended before the selected child, so the parent should have been terminal");
+        selection_result.leaf_game_state.MakeMove(selected_child_node->move_to_get_here);
+        // NOTE(david): the selected child is an unexplored one, or one whose first simulation is still running on another thread
+        if (selected_child_node->num_simulations == selected_child_node->num_virtual_losses)
         {
             return selection_result;
         }
 
-        current_legal_moves.DeleteMove(selected_child_node->move_to_get_here);
-
         current_node = selected_child_node;
     }
 
     return selection_result;
 }
 
-Node *MCST::_Expansion(Node *from_node, NodePool &node_pool)
+Node *MCST::_Expansion(Node *from_node, Move move, u32 number_of_legal_moves, u64 position_key, NodePool &node_pool)
 {
-    Node *result = node_pool.AllocateNode(from_node);
+    Node *result = node_pool.AddChild(from_node, move, number_of_legal_moves, position_key);
+    if (result == nullptr)
+    {
+        return nullptr;
+    }
     if (!(from_node->controlled_type == ControlledType::CONTROLLED || from_node->controlled_type == ControlledType::UNCONTROLLED))
     {
-        DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, *debug_game_state);
+        DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, *debug_game_state, _debug_tree_id);
         LOG(cerr, "from_node: " << from_node);
         assert((from_node->controlled_type == ControlledType::CONTROLLED || from_node->controlled_type == ControlledType::UNCONTROLLED) && "from_node's controlled type is not initialized");
     }
@@ -1152,108 +1507,120 @@ TerminalType Node::UpdateTerminalDepthForParentNode(TerminalType terminal_type_t
         return result;
     }
 
+    TerminalDepth *terminal_depth = node_pool.GetTerminalDepth(this);
+    TerminalDepth *parent_terminal_depth = node_pool.GetTerminalDepth(parent);
     switch (terminal_type_to_update)
     {
         case TerminalType::WINNING: {
-            assert(this->terminal_info.terminal_depth.winning > 0 && "child's winning terminal depth hasn't been initialized");
-            if (parent->terminal_info.terminal_depth.winning == 0)
+            assert(terminal_depth->winning > 0 && "child's winning terminal depth hasn't been initialized");
+            if (parent_terminal_depth->winning == 0)
             {
                 // NOTE(david): if winning terminal depth hasn't been initialize yet, initialize it
-                parent->terminal_info.terminal_depth.winning = this->terminal_info.terminal_depth.winning;
-                parent->terminal_info.terminal_depth.winning_continuation = this->move_to_get_here;
+                parent_terminal_depth->winning = terminal_depth->winning;
+                parent_terminal_depth->winning_continuation = this->move_to_get_here;
 
                 // NOTE(david): need to update grandparent
                 result = terminal_type_to_update;
             }
             else
             {
-                assert(parent->terminal_info.terminal_depth.winning_continuation.IsValid() && "if winning continuation isn't initialized, handle it in separate condition");
+                assert(parent_terminal_depth->winning_continuation.IsValid() && "if winning continuation isn't initialized, handle it in separate condition");
                 switch (parent->controlled_type)
                 {
                     case ControlledType::CONTROLLED: {
-                        if (this->move_to_get_here == parent->terminal_info.terminal_depth.winning_continuation)
+                        if (this->move_to_get_here == parent_terminal_depth->winning_continuation)
                         {
                             // NOTE(david): winning terminal depth is from the same child
 
-                            if (this->terminal_info.terminal_depth.winning < parent->terminal_info.terminal_depth.winning)
+                            if (terminal_depth->winning < parent_terminal_depth->winning)
                             {
-                                parent->terminal_info.terminal_depth.winning = this->terminal_info.terminal_depth.winning;
+                                parent_terminal_depth->winning = terminal_depth->winning;
                                 // NOTE(david): improved winning terminal depth, need to update grandparent
                                 result = terminal_type_to_update;
                             }
-                            else if (this->terminal_info.terminal_depth.winning > parent->terminal_info.terminal_depth.winning)
+                            else if (terminal_depth->winning > parent_terminal_depth->winning)
                             {
                                 // NOTE(david): previously best continuation now has worse winning terminal depth -> recheck parent's children for best winning continuation
                                 NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent);
                                 for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
                                 {
-                                    Node *child = children_nodes->children[child_index];
-                                    if (child->terminal_info.terminal_depth.winning == 0)
+                                    Node *child = &children_nodes->children[child_index];
+                                    if (child->is_tombstone)
+                                    {
+                                        continue ;
+                                    }
+                                    TerminalDepth *child_terminal_depth = node_pool.GetTerminalDepth(child);
+                                    if (child_terminal_depth->winning == 0)
                                     {
                                         continue ;
                                     }
                                     if (child_index == 0)
                                     {
-                                        parent->terminal_info.terminal_depth.winning = child->terminal_info.terminal_depth.winning;
-                                        parent->terminal_info.terminal_depth.winning_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->winning = child_terminal_depth->winning;
+                                        parent_terminal_depth->winning_continuation = child->move_to_get_here;
                                     }
-                                    else if (child->terminal_info.terminal_depth.winning < parent->terminal_info.terminal_depth.winning)
+                                    else if (child_terminal_depth->winning < parent_terminal_depth->winning)
                                     {
-                                        parent->terminal_info.terminal_depth.winning = child->terminal_info.terminal_depth.winning;
-                                        parent->terminal_info.terminal_depth.winning_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->winning = child_terminal_depth->winning;
+                                        parent_terminal_depth->winning_continuation = child->move_to_get_here;
                                     }
                                 }
                                 result = terminal_type_to_update;
                             }
                         }
-                        else if (this->terminal_info.terminal_depth.winning < parent->terminal_info.terminal_depth.winning)
+                        else if (terminal_depth->winning < parent_terminal_depth->winning)
                         {
-                            parent->terminal_info.terminal_depth.winning = this->terminal_info.terminal_depth.winning;
-                            parent->terminal_info.terminal_depth.winning_continuation = this->move_to_get_here;
+                            parent_terminal_depth->winning = terminal_depth->winning;
+                            parent_terminal_depth->winning_continuation = this->move_to_get_here;
 
                             result = terminal_type_to_update;
                         }
                     } break ;
                     case ControlledType::UNCONTROLLED: {
-                        if (this->move_to_get_here == parent->terminal_info.terminal_depth.winning_continuation)
+                        if (this->move_to_get_here == parent_terminal_depth->winning_continuation)
                         {
                             // NOTE(david): winning terminal depth is from the same child
 
-                            if (this->terminal_info.terminal_depth.winning > parent->terminal_info.terminal_depth.winning)
+                            if (terminal_depth->winning > parent_terminal_depth->winning)
                             {
-                                parent->terminal_info.terminal_depth.winning = this->terminal_info.terminal_depth.winning;
+                                parent_terminal_depth->winning = terminal_depth->winning;
                                 // NOTE(david): improved winning terminal depth, need to update grandparent
                                 result = terminal_type_to_update;
                             }
-                            else if (this->terminal_info.terminal_depth.winning < parent->terminal_info.terminal_depth.winning)
+                            else if (terminal_depth->winning < parent_terminal_depth->winning)
                             {
                                 // NOTE(david): previously best continuation now has worse winning terminal depth -> recheck parent's children for best winning continuation
                                 NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent);
                                 for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
                                 {
-                                    Node *child = children_nodes->children[child_index];
-                                    if (child->terminal_info.terminal_depth.winning == 0)
+                                    Node *child = &children_nodes->children[child_index];
+                                    if (child->is_tombstone)
+                                    {
+                                        continue ;
+                                    }
+                                    TerminalDepth *child_terminal_depth = node_pool.GetTerminalDepth(child);
+                                    if (child_terminal_depth->winning == 0)
                                     {
                                         continue ;
                                     }
                                     if (child_index == 0)
                                     {
-                                        parent->terminal_info.terminal_depth.winning = child->terminal_info.terminal_depth.winning;
-                                        parent->terminal_info.terminal_depth.winning_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->winning = child_terminal_depth->winning;
+                                        parent_terminal_depth->winning_continuation = child->move_to_get_here;
                                     }
-                                    else if (child->terminal_info.terminal_depth.winning > parent->terminal_info.terminal_depth.winning)
+                                    else if (child_terminal_depth->winning > parent_terminal_depth->winning)
                                     {
-                                        parent->terminal_info.terminal_depth.winning = child->terminal_info.terminal_depth.winning;
-                                        parent->terminal_info.terminal_depth.winning_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->winning = child_terminal_depth->winning;
+                                        parent_terminal_depth->winning_continuation = child->move_to_get_here;
                                     }
                                 }
                                 result = terminal_type_to_update;
                             }
                         }
-                        else if (this->terminal_info.terminal_depth.winning > parent->terminal_info.terminal_depth.winning)
+                        else if (terminal_depth->winning > parent_terminal_depth->winning)
                         {
-                            parent->terminal_info.terminal_depth.winning = this->terminal_info.terminal_depth.winning;
-                            parent->terminal_info.terminal_depth.winning_continuation = this->move_to_get_here;
+                            parent_terminal_depth->winning = terminal_depth->winning;
+                            parent_terminal_depth->winning_continuation = this->move_to_get_here;
 
                             result = terminal_type_to_update;
                         }
@@ -1263,105 +1630,115 @@ TerminalType Node::UpdateTerminalDepthForParentNode(TerminalType terminal_type_t
             }
         } break ;
         case TerminalType::LOSING: {
-            assert(this->terminal_info.terminal_depth.losing > 0 && "child's losing terminal depth hasn't been initialized");
-            if (parent->terminal_info.terminal_depth.losing == 0)
+            assert(terminal_depth->losing > 0 && "child's losing terminal depth hasn't been initialized");
+            if (parent_terminal_depth->losing == 0)
             {
                 // NOTE(david): if losing terminal depth hasn't been initialize yet, initialize it
-                parent->terminal_info.terminal_depth.losing = this->terminal_info.terminal_depth.losing;
-                parent->terminal_info.terminal_depth.losing_continuation = this->move_to_get_here;
+                parent_terminal_depth->losing = terminal_depth->losing;
+                parent_terminal_depth->losing_continuation = this->move_to_get_here;
 
                 // NOTE(david): need to update grandparent
                 result = terminal_type_to_update;
             }
             else
             {
-                assert(parent->terminal_info.terminal_depth.losing_continuation.IsValid() && "if losing continuation isn't initialized, handle it in separate condition");
+                assert(parent_terminal_depth->losing_continuation.IsValid() && "if losing continuation isn't initialized, handle it in separate condition");
                 switch (parent->controlled_type)
                 {
                     case ControlledType::CONTROLLED: {
-                        if (this->move_to_get_here == parent->terminal_info.terminal_depth.losing_continuation)
+                        if (this->move_to_get_here == parent_terminal_depth->losing_continuation)
                         {
                             // NOTE(david): losing terminal depth is from the same child
 
-                            if (this->terminal_info.terminal_depth.losing > parent->terminal_info.terminal_depth.losing)
+                            if (terminal_depth->losing > parent_terminal_depth->losing)
                             {
-                                parent->terminal_info.terminal_depth.losing = this->terminal_info.terminal_depth.losing;
+                                parent_terminal_depth->losing = terminal_depth->losing;
                                 // NOTE(david): improved losing terminal depth, need to update grandparent
                                 result = terminal_type_to_update;
                             }
-                            else if (this->terminal_info.terminal_depth.losing < parent->terminal_info.terminal_depth.losing)
+                            else if (terminal_depth->losing < parent_terminal_depth->losing)
                             {
                                 // NOTE(david): previously best continuation now has worse losing terminal depth -> recheck parent's children for best losing continuation
                                 NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent);
                                 for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
                                 {
-                                    Node *child = children_nodes->children[child_index];
-                                    if (child->terminal_info.terminal_depth.losing == 0)
+                                    Node *child = &children_nodes->children[child_index];
+                                    if (child->is_tombstone)
+                                    {
+                                        continue ;
+                                    }
+                                    TerminalDepth *child_terminal_depth = node_pool.GetTerminalDepth(child);
+                                    if (child_terminal_depth->losing == 0)
                                     {
                                         continue ;
                                     }
                                     if (child_index == 0)
                                     {
-                                        parent->terminal_info.terminal_depth.losing = child->terminal_info.terminal_depth.losing;
-                                        parent->terminal_info.terminal_depth.losing_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->losing = child_terminal_depth->losing;
+                                        parent_terminal_depth->losing_continuation = child->move_to_get_here;
                                     }
-                                    else if (child->terminal_info.terminal_depth.losing > parent->terminal_info.terminal_depth.losing)
+                                    else if (child_terminal_depth->losing > parent_terminal_depth->losing)
                                     {
-                                        parent->terminal_info.terminal_depth.losing = child->terminal_info.terminal_depth.losing;
-                                        parent->terminal_info.terminal_depth.losing_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->losing = child_terminal_depth->losing;
+                                        parent_terminal_depth->losing_continuation = child->move_to_get_here;
                                     }
                                 }
                                 result = terminal_type_to_update;
                             }
                         }
-                        else if (this->terminal_info.terminal_depth.losing > parent->terminal_info.terminal_depth.losing)
+                        else if (terminal_depth->losing > parent_terminal_depth->losing)
                         {
-                            parent->terminal_info.terminal_depth.losing = this->terminal_info.terminal_depth.losing;
-                            parent->terminal_info.terminal_depth.losing_continuation = this->move_to_get_here;
+                            parent_terminal_depth->losing = terminal_depth->losing;
+                            parent_terminal_depth->losing_continuation = this->move_to_get_here;
 
                             result = terminal_type_to_update;
                         }
                     } break ;
                     case ControlledType::UNCONTROLLED: {
-                        if (this->move_to_get_here == parent->terminal_info.terminal_depth.losing_continuation)
+                        if (this->move_to_get_here == parent_terminal_depth->losing_continuation)
                         {
                             // NOTE(david): losing terminal depth is from the same child
 
-                            if (this->terminal_info.terminal_depth.losing < parent->terminal_info.terminal_depth.losing)
+                            if (terminal_depth->losing < parent_terminal_depth->losing)
                             {
-                                parent->terminal_info.terminal_depth.losing = this->terminal_info.terminal_depth.losing;
+                                parent_terminal_depth->losing = terminal_depth->losing;
                                 // NOTE(david): improved losing terminal depth, need to update grandparent
                                 result = terminal_type_to_update;
                             }
-                            else if (this->terminal_info.terminal_depth.losing > parent->terminal_info.terminal_depth.losing)
+                            else if (terminal_depth->losing > parent_terminal_depth->losing)
                             {
                                 // NOTE(david): previously best continuation now has worse losing terminal depth -> recheck parent's children for best losing continuation
                                 NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent);
                                 for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
                                 {
-                                    Node *child = children_nodes->children[child_index];
-                                    if (child->terminal_info.terminal_depth.losing == 0)
+                                    Node *child = &children_nodes->children[child_index];
+                                    if (child->is_tombstone)
+                                    {
+                                        continue ;
+                                    }
+                                    TerminalDepth *child_terminal_depth = node_pool.GetTerminalDepth(child);
+                                    if (child_terminal_depth->losing == 0)
                                     {
                                         continue ;
                                     }
                                     if (child_index == 0)
                                     {
-                                        parent->terminal_info.terminal_depth.losing = child->terminal_info.terminal_depth.losing;
-                                        parent->terminal_info.terminal_depth.losing_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->losing = child_terminal_depth->losing;
+                                        parent_terminal_depth->losing_continuation = child->move_to_get_here;
                                     }
-                                    else if (child->terminal_info.terminal_depth.losing < parent->terminal_info.terminal_depth.losing)
+                                    else if (child_terminal_depth->losing < parent_terminal_depth->losing)
                                     {
-                                        parent->terminal_info.terminal_depth.losing = child->terminal_info.terminal_depth.losing;
-                                        parent->terminal_info.terminal_depth.losing_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->losing = child_terminal_depth->losing;
+                                        parent_terminal_depth->losing_continuation = child->move_to_get_here;
                                     }
                                 }
                                 result = terminal_type_to_update;
                             }
                         }
-                        else if (this->terminal_info.terminal_depth.losing < parent->terminal_info.terminal_depth.losing)
+                        else if (terminal_depth->losing < parent_terminal_depth->losing)
                         {
-                            parent->terminal_info.terminal_depth.losing = this->terminal_info.terminal_depth.losing;
-                            parent->terminal_info.terminal_depth.losing_continuation = this->move_to_get_here;
+                            parent_terminal_depth->losing = terminal_depth->losing;
+                            parent_terminal_depth->losing_continuation = this->move_to_get_here;
 
                             result = terminal_type_to_update;
                         }
@@ -1371,105 +1748,115 @@ TerminalType Node::UpdateTerminalDepthForParentNode(TerminalType terminal_type_t
             }
         } break ;
         case TerminalType::NEUTRAL: {
-            assert(this->terminal_info.terminal_depth.neutral > 0 && "child's neutral terminal depth hasn't been initialized");
-            if (parent->terminal_info.terminal_depth.neutral == 0)
+            assert(terminal_depth->neutral > 0 && "child's neutral terminal depth hasn't been initialized");
+            if (parent_terminal_depth->neutral == 0)
             {
                 // NOTE(david): if neutral terminal depth hasn't been initialize yet, initialize it
-                parent->terminal_info.terminal_depth.neutral = this->terminal_info.terminal_depth.neutral;
-                parent->terminal_info.terminal_depth.neutral_continuation = this->move_to_get_here;
+                parent_terminal_depth->neutral = terminal_depth->neutral;
+                parent_terminal_depth->neutral_continuation = this->move_to_get_here;
 
                 // NOTE(david): need to update the grandparent's neutral terminal depth as well
                 result = terminal_type_to_update;
             }
             else
             {
-                assert(parent->terminal_info.terminal_depth.neutral_continuation.IsValid() && "if neutral continuation isn't initialized, handle it in separate condition");
+                assert(parent_terminal_depth->neutral_continuation.IsValid() && "if neutral continuation isn't initialized, handle it in separate condition");
                 switch (parent->controlled_type)
                 {
                     case ControlledType::CONTROLLED: {
-                        if (this->move_to_get_here == parent->terminal_info.terminal_depth.neutral_continuation)
+                        if (this->move_to_get_here == parent_terminal_depth->neutral_continuation)
                         {
                             // NOTE(david): neutral terminal depth is from the same child
 
-                            if (this->terminal_info.terminal_depth.neutral > parent->terminal_info.terminal_depth.neutral)
+                            if (terminal_depth->neutral > parent_terminal_depth->neutral)
                             {
-                                parent->terminal_info.terminal_depth.neutral = this->terminal_info.terminal_depth.neutral;
+                                parent_terminal_depth->neutral = terminal_depth->neutral;
                                 // NOTE(david): improved neutral terminal depth, need to update grandparent
                                 result = terminal_type_to_update;
                             }
-                            else if (this->terminal_info.terminal_depth.neutral < parent->terminal_info.terminal_depth.neutral)
+                            else if (terminal_depth->neutral < parent_terminal_depth->neutral)
                             {
                                 // NOTE(david): previously best continuation now has worse neutral terminal depth -> recheck parent's children for best neutral continuation
                                 NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent);
                                 for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
                                 {
-                                    Node *child = children_nodes->children[child_index];
-                                    if (child->terminal_info.terminal_depth.neutral == 0)
+                                    Node *child = &children_nodes->children[child_index];
+                                    if (child->is_tombstone)
+                                    {
+                                        continue ;
+                                    }
+                                    TerminalDepth *child_terminal_depth = node_pool.GetTerminalDepth(child);
+                                    if (child_terminal_depth->neutral == 0)
                                     {
                                         continue ;
                                     }
                                     if (child_index == 0)
                                     {
-                                        parent->terminal_info.terminal_depth.neutral = child->terminal_info.terminal_depth.neutral;
-                                        parent->terminal_info.terminal_depth.neutral_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->neutral = child_terminal_depth->neutral;
+                                        parent_terminal_depth->neutral_continuation = child->move_to_get_here;
                                     }
-                                    else if (child->terminal_info.terminal_depth.neutral > parent->terminal_info.terminal_depth.neutral)
+                                    else if (child_terminal_depth->neutral > parent_terminal_depth->neutral)
                                     {
-                                        parent->terminal_info.terminal_depth.neutral = child->terminal_info.terminal_depth.neutral;
-                                        parent->terminal_info.terminal_depth.neutral_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->neutral = child_terminal_depth->neutral;
+                                        parent_terminal_depth->neutral_continuation = child->move_to_get_here;
                                     }
                                 }
                                 result = terminal_type_to_update;
                             }
                         }
-                        else if (this->terminal_info.terminal_depth.neutral > parent->terminal_info.terminal_depth.neutral)
+                        else if (terminal_depth->neutral > parent_terminal_depth->neutral)
                         {
-                            parent->terminal_info.terminal_depth.neutral = this->terminal_info.terminal_depth.neutral;
-                            parent->terminal_info.terminal_depth.neutral_continuation = this->move_to_get_here;
+                            parent_terminal_depth->neutral = terminal_depth->neutral;
+                            parent_terminal_depth->neutral_continuation = this->move_to_get_here;
 
                             result = terminal_type_to_update;
                         }
                     } break ;
                     case ControlledType::UNCONTROLLED: {
-                        if (this->move_to_get_here == parent->terminal_info.terminal_depth.neutral_continuation)
+                        if (this->move_to_get_here == parent_terminal_depth->neutral_continuation)
                         {
                             // NOTE(david): neutral terminal depth is from the same child
 
-                            if (this->terminal_info.terminal_depth.neutral > parent->terminal_info.terminal_depth.neutral)
+                            if (terminal_depth->neutral > parent_terminal_depth->neutral)
                             {
-                                parent->terminal_info.terminal_depth.neutral = this->terminal_info.terminal_depth.neutral;
+                                parent_terminal_depth->neutral = terminal_depth->neutral;
                                 // NOTE(david): improved neutral terminal depth, need to update grandparent
                                 result = terminal_type_to_update;
                             }
-                            else if (this->terminal_info.terminal_depth.neutral < parent->terminal_info.terminal_depth.neutral)
+                            else if (terminal_depth->neutral < parent_terminal_depth->neutral)
                             {
                                 // NOTE(david): previously best continuation now has worse neutral terminal depth -> recheck parent's children for best neutral continuation
                                 NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(parent);
                                 for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
                                 {
-                                    Node *child = children_nodes->children[child_index];
-                                    if (child->terminal_info.terminal_depth.neutral == 0)
+                                    Node *child = &children_nodes->children[child_index];
+                                    if (child->is_tombstone)
+                                    {
+                                        continue ;
+                                    }
+                                    TerminalDepth *child_terminal_depth = node_pool.GetTerminalDepth(child);
+                                    if (child_terminal_depth->neutral == 0)
                                     {
                                         continue ;
                                     }
                                     if (child_index == 0)
                                     {
-                                        parent->terminal_info.terminal_depth.neutral = child->terminal_info.terminal_depth.neutral;
-                                        parent->terminal_info.terminal_depth.neutral_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->neutral = child_terminal_depth->neutral;
+                                        parent_terminal_depth->neutral_continuation = child->move_to_get_here;
                                     }
-                                    else if (child->terminal_info.terminal_depth.neutral > parent->terminal_info.terminal_depth.neutral)
+                                    else if (child_terminal_depth->neutral > parent_terminal_depth->neutral)
                                     {
-                                        parent->terminal_info.terminal_depth.neutral = child->terminal_info.terminal_depth.neutral;
-                                        parent->terminal_info.terminal_depth.neutral_continuation = child->move_to_get_here;
+                                        parent_terminal_depth->neutral = child_terminal_depth->neutral;
+                                        parent_terminal_depth->neutral_continuation = child->move_to_get_here;
                                     }
                                 }
                                 result = terminal_type_to_update;
                             }
                         }
-                        else if (this->terminal_info.terminal_depth.neutral > parent->terminal_info.terminal_depth.neutral)
+                        else if (terminal_depth->neutral > parent_terminal_depth->neutral)
                         {
-                            parent->terminal_info.terminal_depth.neutral = this->terminal_info.terminal_depth.neutral;
-                            parent->terminal_info.terminal_depth.neutral_continuation = this->move_to_get_here;
+                            parent_terminal_depth->neutral = terminal_depth->neutral;
+                            parent_terminal_depth->neutral_continuation = this->move_to_get_here;
 
                             result = terminal_type_to_update;
                         }
@@ -1495,12 +1882,11 @@ void MCST::PruneNode(Node *node_to_prune, NodePool &node_pool)
     Node *cur_node = node_to_prune->parent;
     while (cur_node != nullptr)
     {
-        cur_node->value -= node_to_prune->value;
         assert(cur_node->num_simulations >= node_to_prune->num_simulations);
-        cur_node->num_simulations -= node_to_prune->num_simulations;
+        AddStatistics(cur_node, node_pool, -node_to_prune->value, -(i32)node_to_prune->num_simulations);
         if (cur_node->num_simulations == 0)
         {
-            DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, *debug_game_state);
+            DebugPrintDecisionTree(_root_node, g_move_counter, node_pool, *debug_game_state, _debug_tree_id);
             LOG(cerr, "node_to_prune: " << node_to_prune);
             LOG(cerr, "cur_node: " << cur_node);
             assert(false && "this shouldn't be possible, as the node's children's total number of simulation should be less than the parent's, as there is at least 1 unique simulation from the parent");
@@ -1509,16 +1895,120 @@ void MCST::PruneNode(Node *node_to_prune, NodePool &node_pool)
         cur_node = cur_node->parent;
     }
 
-    // NOTE(david): after done updating the parents, free the node and its children
+    // NOTE(david): after done updating the parents, free the children of the node, the node itself stays as a tombstone in its parent's children block
     node_pool.FreeNode(node_to_prune);
 }
 
+u32 MCST::_EvictColdSubtrees(NodePool &node_pool, u32 failed_block_size)
+{
+    node_pool.ResetFailedBlockSize();
+
+    u32 high_watermark_number_of_nodes = (u32)(eviction_high_watermark * node_pool.MaxNumberOfNodes());
+    if (failed_block_size > 0)
+    {
+        // NOTE(david): an allocation usually fails below the watermark because the free nodes are split into blocks that are too small, in which case merging them is enough and nothing has to be evicted
+        node_pool.CoalesceFreeBlocks();
+        if (node_pool.CurrentAllocatedNodes() < high_watermark_number_of_nodes && node_pool.CanAllocateBlock(failed_block_size))
+        {
+            _next_eviction_num_simulations = 0;
+            return 0;
+        }
+    }
+
+    // NOTE(david): collect every expanded node that no search thread is simulating below, as their subtrees can be freed without invalidating the nodes held outside of the tree lock
+    vector<Node *> eviction_candidates;
+    vector<Node *> nodes_to_visit;
+    nodes_to_visit.push_back(_root_node);
+    while (nodes_to_visit.empty() == false)
+    {
+        Node *cur_node = nodes_to_visit.back();
+        nodes_to_visit.pop_back();
+        NodePool::ChildrenTables *children_table = node_pool.GetChildren(cur_node);
+        if (children_table->children == nullptr)
+        {
+            continue ;
+        }
+        if (cur_node != _root_node && cur_node->num_virtual_losses == 0)
+        {
+            eviction_candidates.push_back(cur_node);
+        }
+        for (u32 child_index = 0; child_index < children_table->number_of_children; ++child_index)
+        {
+            Node *child_node = &children_table->children[child_index];
+            if (child_node->is_tombstone == false)
+            {
+                nodes_to_visit.push_back(child_node);
+            }
+        }
+    }
+
+    // NOTE(david): least visited first, a node has at least as many simulations as any of its descendants, so on a tie the deeper node goes first, this way a subtree is never visited after one of its ancestors has already freed it
+    sort(eviction_candidates.begin(), eviction_candidates.end(), [](Node *a, Node *b) {
+        if (a->num_simulations != b->num_simulations)
+        {
+            return a->num_simulations < b->num_simulations;
+        }
+        return a->depth > b->depth;
+    });
+
+    // NOTE(david): the node keeps its value and number of simulations, which already include the ones of its subtree, so the statistics are folded into it and it's expanded again once it's selected
+    u32 target_number_of_nodes = (u32)(eviction_low_watermark * node_pool.MaxNumberOfNodes());
+    u32 min_number_of_nodes_to_free = (u32)(eviction_min_freed_share_after_failed_allocation * node_pool.MaxNumberOfNodes());
+    u32 max_number_of_nodes_to_free = (u32)(eviction_max_freed_share_after_failed_allocation * node_pool.MaxNumberOfNodes());
+    u32 total_number_of_freed_nodes_before = node_pool.TotalNumberOfFreedNodes();
+    u32 number_of_freed_nodes_to_coalesce_at = min_number_of_nodes_to_free;
+    for (Node *eviction_candidate : eviction_candidates)
+    {
+        if (node_pool.CurrentAllocatedNodes() <= target_number_of_nodes)
+        {
+            if (failed_block_size == 0)
+            {
+                break ;
+            }
+            // NOTE(david): the failed block can still be too large for the free nodes between the live blocks, so keep going until it can be served, but free at most a fixed share of the pool in case it can't be
+            // merging is a pass over the whole pool, so it's only done after every min share of freed nodes
+            u32 number_of_freed_nodes = node_pool.TotalNumberOfFreedNodes() - total_number_of_freed_nodes_before;
+            if (number_of_freed_nodes >= max_number_of_nodes_to_free)
+            {
+                break ;
+            }
+            if (number_of_freed_nodes >= number_of_freed_nodes_to_coalesce_at)
+            {
+                node_pool.CoalesceFreeBlocks();
+                if (node_pool.CanAllocateBlock(failed_block_size))
+                {
+                    break ;
+                }
+                number_of_freed_nodes_to_coalesce_at = number_of_freed_nodes + min_number_of_nodes_to_free;
+            }
+        }
+        node_pool.FreeChildren(eviction_candidate);
+    }
+
+    u32 number_of_freed_nodes = node_pool.TotalNumberOfFreedNodes() - total_number_of_freed_nodes_before;
+    if (number_of_freed_nodes > 0)
+    {
+        node_pool.CoalesceFreeBlocks();
+    }
+    if (number_of_freed_nodes == 0)
+    {
+        // NOTE(david): every candidate is held by a search thread, or there are none, wait with the next pass for as many simulations as there are nodes in the tree, so that the cost of the passes stays constant per simulation
+        _next_eviction_num_simulations = _root_node->num_simulations + node_pool.CurrentAllocatedNodes();
+    }
+    else
+    {
+        _next_eviction_num_simulations = 0;
+    }
+
+    return number_of_freed_nodes;
+}
+
 void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationResult simulation_result)
 {
     assert(simulated_node != _root_node && "root node is not a valid move so it couldn't have been simulated");
-    assert(_root_node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL);
+    assert(_root_node->terminal_type == TerminalType::NOT_TERMINAL);
 
-    assert(simulated_node->terminal_info.terminal_type != TerminalType::NOT_TERMINAL || simulated_node->num_simulations == 1 && "TODO: current implementation: simulate once, I need to reintroduce this number to the simulation result maybe");
+    assert((simulated_node->terminal_type != TerminalType::NOT_TERMINAL || simulated_node->num_simulations >= simulation_result.num_simulations) && "the simulation result has to be applied to the simulated node before backpropagating it");
 
     /*
         NOTE(david): don't backpropagate if the node needs to be pruned
@@ -1528,28 +2018,28 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
     */
 
     TerminalType should_update_parent_terminal_depth_from_its_children = TerminalType::NOT_TERMINAL;
-    if (simulated_node->terminal_info.terminal_type != TerminalType::NOT_TERMINAL)
+    if (simulated_node->terminal_type != TerminalType::NOT_TERMINAL)
     {
         Node *parent_node = simulated_node->parent;
         assert(parent_node != nullptr && "node can't be root to propagate back from, as if it was terminal we should have already returned an evaluation result");
 
-        should_update_parent_terminal_depth_from_its_children = simulated_node->UpdateTerminalDepthForParentNode(simulated_node->terminal_info.terminal_type, node_pool);
+        should_update_parent_terminal_depth_from_its_children = simulated_node->UpdateTerminalDepthForParentNode(simulated_node->terminal_type, node_pool);
 
         // TODO(david): whenever a node's terminal type is set, also set it's terminal depth -> move this to a centralized place
         switch (parent_node->controlled_type)
         {
             case ControlledType::CONTROLLED: {
-                if (simulated_node->terminal_info.terminal_type == TerminalType::WINNING)
+                if (simulated_node->terminal_type == TerminalType::WINNING)
                 {
-                    parent_node->terminal_info.terminal_type = TerminalType::WINNING;
-                    // parent_node->terminal_info.terminal_depth.winning = parent_node->depth;
+                    parent_node->terminal_type = TerminalType::WINNING;
+                    // node_pool.GetTerminalDepth(parent_node)->winning = parent_node->depth;
                 }
             } break ;
             case ControlledType::UNCONTROLLED: {
-                if (simulated_node->terminal_info.terminal_type == TerminalType::LOSING)
+                if (simulated_node->terminal_type == TerminalType::LOSING)
                 {
-                    parent_node->terminal_info.terminal_type = TerminalType::LOSING;
-                    // parent_node->terminal_info.terminal_depth.losing = parent_node->depth;
+                    parent_node->terminal_type = TerminalType::LOSING;
+                    // node_pool.GetTerminalDepth(parent_node)->losing = parent_node->depth;
                 }
             } break ;
             default: UNREACHABLE_CODE;
@@ -1567,8 +2057,7 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
             should_update_parent_terminal_depth_from_its_children = cur_node->UpdateTerminalDepthForParentNode(should_update_parent_terminal_depth_from_its_children, node_pool);
         }
 
-        cur_node->num_simulations += simulation_result.num_simulations;
-        cur_node->value += simulation_result.value;
+        AddStatistics(cur_node, node_pool, simulation_result.value, simulation_result.num_simulations);
 
         if (cur_node != _root_node)
         {
@@ -1578,7 +2067,8 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
             assert(cur_node->depth > 0);
             // TODO(david): the number of simulations treshold should maybe be a dynamic parameter depending on how much time is allowed to think
             u32 number_of_simulations_treshold = (u32)(3000.0 / sqrt(cur_node->depth)) + 50;
-            if (cur_node->num_simulations >= number_of_simulations_treshold)
+            // NOTE(david): can't prune while other threads are simulating from the node's subtree
+            if (cur_node->num_simulations >= number_of_simulations_treshold && cur_node->num_virtual_losses == 0)
             {
                 constexpr r64 lower_mean_prune_treshold = -0.95;
                 constexpr r64 upper_mean_prune_treshold = 0.95;
@@ -1597,16 +2087,15 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
                         case ControlledType::UNCONTROLLED: {
                             if (parent_node)
                             {
-                                parent_node->terminal_info.terminal_type = TerminalType::LOSING;
-                                parent_node->terminal_info.terminal_depth.losing = parent_node->depth;
+                                parent_node->terminal_type = TerminalType::LOSING;
+                                node_pool.GetTerminalDepth(parent_node)->losing = parent_node->depth;
                                 cur_node->UpdateTerminalDepthForParentNode(TerminalType::LOSING, node_pool);
                             }
                         } break ;
                         default: UNREACHABLE_CODE;
                     }
                     // NOTE(david): haven't finished backpropagation of the simulation, so account for this fact
-                    cur_node->num_simulations -= simulation_result.num_simulations;
-                    cur_node->value -= simulation_result.value;
+                    AddStatistics(cur_node, node_pool, -simulation_result.value, -(i32)simulation_result.num_simulations);
                     PruneNode(cur_node, node_pool);
                     return ;
                 }
@@ -1619,8 +2108,8 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
                         case ControlledType::CONTROLLED: {
                             if (parent_node)
                             {
-                                parent_node->terminal_info.terminal_type = TerminalType::WINNING;
-                                parent_node->terminal_info.terminal_depth.winning = parent_node->depth;
+                                parent_node->terminal_type = TerminalType::WINNING;
+                                node_pool.GetTerminalDepth(parent_node)->winning = parent_node->depth;
                                 cur_node->UpdateTerminalDepthForParentNode(TerminalType::WINNING, node_pool);
                             }
                         } break ;
@@ -1629,8 +2118,7 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
                         default: UNREACHABLE_CODE;
                     }
                     // NOTE(david): haven't finished backpropagation of the simulation, so account for this fact
-                    cur_node->num_simulations -= simulation_result.num_simulations;
-                    cur_node->value -= simulation_result.value;
+                    AddStatistics(cur_node, node_pool, -simulation_result.value, -(i32)simulation_result.num_simulations);
                     PruneNode(cur_node, node_pool);
                     return ;
                 }
@@ -1641,7 +2129,458 @@ void MCST::_BackPropagate(Node *simulated_node, NodePool &node_pool, SimulationR
     }
 }
 
+void MCST::AdvanceRoot(Move move_played, NodePool &node_pool)
+{
+    if (_reuse_tree == false || _root_node == nullptr)
+    {
+        return ;
+    }
+
+    Node *new_root_node = nullptr;
+    NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(_root_node);
+    for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+    {
+        Node *child_node = &children_nodes->children[child_index];
+        if (child_node->is_tombstone)
+        {
+            continue ;
+        }
+        assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
+        if (child_node->move_to_get_here == move_played)
+        {
+            new_root_node = child_node;
+            break ;
+        }
+    }
+
+    if (new_root_node == nullptr)
+    {
+        // NOTE(david): the move played was either never expanded or it has been pruned, so there is nothing to reuse
+        ResetTree(node_pool);
+        return ;
+    }
+
+    // NOTE(david): the new root is moved out of the children block of the old root, so that the old root can be freed together with the siblings of the move played
+    new_root_node = node_pool.DetachNode(new_root_node);
+    if (new_root_node == nullptr)
+    {
+        // NOTE(david): the node pool is out of nodes, so start from scratch
+        ResetTree(node_pool);
+        return ;
+    }
+    node_pool.FreeNode(_root_node);
+    _root_node = new_root_node;
+    _next_eviction_num_simulations = 0;
+
+    RebaseDepth(_root_node, _root_node->depth, node_pool);
+
+    if (_root_node->terminal_type != TerminalType::NOT_TERMINAL && node_pool.GetChildren(_root_node)->number_of_children == 0)
+    {
+        // NOTE(david): terminal leaf, there is no move to select from it, so start from scratch next time
+        ResetTree(node_pool);
+    }
+}
+
+void MCST::ResetTree(NodePool &node_pool)
+{
+    node_pool.Clear();
+    _root_node = nullptr;
+    _next_eviction_num_simulations = 0;
+}
+
+void MCST::SetDebugTreeId(u32 debug_tree_id)
+{
+    _debug_tree_id = debug_tree_id;
+}
+
+void MCST::SetFirstRandomStreamIndex(u32 first_random_stream_index)
+{
+    _first_random_stream_index = first_random_stream_index;
+}
+
+void MCST::RebaseDepth(Node *from_node, u16 depth_offset, NodePool &node_pool)
+{
+    // NOTE(david): depth and terminal depths are relative to the root, as they are used to compare the children of a node, it's enough to shift them by the same amount
+    assert(from_node->depth >= depth_offset);
+    from_node->depth -= depth_offset;
+    TerminalDepth *terminal_depth = node_pool.GetTerminalDepth(from_node);
+    if (terminal_depth->winning > 0)
+    {
+        assert(terminal_depth->winning >= depth_offset);
+        terminal_depth->winning -= depth_offset;
+    }
+    if (terminal_depth->losing > 0)
+    {
+        assert(terminal_depth->losing >= depth_offset);
+        terminal_depth->losing -= depth_offset;
+    }
+    if (terminal_depth->neutral > 0)
+    {
+        assert(terminal_depth->neutral >= depth_offset);
+        terminal_depth->neutral -= depth_offset;
+    }
+
+    NodePool::ChildrenTables *children_nodes = node_pool.GetChildren(from_node);
+    for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+    {
+        Node *child_node = &children_nodes->children[child_index];
+        if (child_node->is_tombstone)
+        {
+            continue ;
+        }
+        RebaseDepth(child_node, depth_offset, node_pool);
+    }
+}
+
 u32 MCST::NumberOfSimulationsRan(void)
 {
+    if (_root_node == nullptr)
+    {
+        return 0;
+    }
     return _root_node->num_simulations;
 }
+
+MCSTEnsemble::MCSTEnsemble(u32 number_of_trees, u32 number_of_threads_per_tree, u64 memory_ceiling_in_bytes, bool reuse_tree, bool evict_cold_subtrees)
+    : _number_of_trees(number_of_trees)
+{
+    if (_number_of_trees == 0)
+    {
+        _number_of_trees = 1;
+    }
+    else if (_number_of_trees > max_number_of_search_threads)
+    {
+        _number_of_trees = max_number_of_search_threads;
+    }
+
+    // NOTE(david): the trees share the memory ceiling
+    u64 memory_ceiling_in_bytes_per_tree = memory_ceiling_in_bytes / _number_of_trees;
+    u32 first_random_stream_index = 0;
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        _node_pools[tree_index] = new NodePool(memory_ceiling_in_bytes_per_tree);
+        _trees[tree_index] = new MCST(reuse_tree, number_of_threads_per_tree, evict_cold_subtrees);
+        _trees[tree_index]->SetDebugTreeId(tree_index);
+        _trees[tree_index]->SetFirstRandomStreamIndex(first_random_stream_index);
+        first_random_stream_index += _trees[tree_index]->_number_of_threads;
+    }
+}
+
+MCSTEnsemble::~MCSTEnsemble()
+{
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        delete _trees[tree_index];
+        delete _node_pools[tree_index];
+    }
+}
+
+Move MCSTEnsemble::Evaluate(const MoveSet &legal_moveset_at_root_node, TerminationPredicate termination_predicate, SimulateFromState simulation_from_state, const GameState &game_state)
+{
+    if (_number_of_trees == 1)
+    {
+        return _trees[0]->Evaluate(legal_moveset_at_root_node, termination_predicate, simulation_from_state, *_node_pools[0], game_state);
+    }
+
+    if (legal_moveset_at_root_node.NumberOfMoves() == 0)
+    {
+        Move move;
+        move.Invalidate();
+        return move;
+    }
+
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        if (_trees[tree_index]->_reuse_tree == false)
+        {
+            // NOTE(david): the root of the last evaluation is of another position, so it must not be merged before the tree has started its search, its nodes are freed when the search starts
+            _trees[tree_index]->_root_node = nullptr;
+        }
+    }
+
+    // NOTE(david): every tree stops on its own once its root is solved or its pool can't expand the root, the whole ensemble only stops early when the merged result is decisive or every tree has stopped
+    // a tree that has stopped calls the predicate of the ensemble without holding its tree lock, so the root statistics of all the trees can be merged from it
+    atomic<bool> is_tree_stopped[max_number_of_search_threads] = {};
+    atomic<u32> number_of_stopped_trees = 0;
+    TerminationPredicate tree_termination_predicates[max_number_of_search_threads];
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        tree_termination_predicates[tree_index] = [this, tree_index, &is_tree_stopped, &number_of_stopped_trees, &termination_predicate](bool found_perfect_move) {
+            if (found_perfect_move == false)
+            {
+                return is_tree_stopped[tree_index].load(memory_order_relaxed) || termination_predicate(false);
+            }
+            if (is_tree_stopped[tree_index].exchange(true) == false)
+            {
+                u32 number_of_stopped_trees_so_far = number_of_stopped_trees.fetch_add(1) + 1;
+                if (number_of_stopped_trees_so_far == _number_of_trees || _IsMergedResultDecisive())
+                {
+                    termination_predicate(true);
+                }
+            }
+            return true;
+        };
+    }
+
+    // NOTE(david): the calling thread searches the first tree
+    thread tree_threads[max_number_of_search_threads];
+    for (u32 tree_index = 1; tree_index < _number_of_trees; ++tree_index)
+    {
+        tree_threads[tree_index] = thread([this, tree_index, &legal_moveset_at_root_node, &tree_termination_predicates, &simulation_from_state, &game_state]() {
+            _trees[tree_index]->Evaluate(legal_moveset_at_root_node, tree_termination_predicates[tree_index], simulation_from_state, *_node_pools[tree_index], game_state);
+            MERGE_THREAD_JOBS;
+        });
+    }
+    _trees[0]->Evaluate(legal_moveset_at_root_node, tree_termination_predicates[0], simulation_from_state, *_node_pools[0], game_state);
+    for (u32 tree_index = 1; tree_index < _number_of_trees; ++tree_index)
+    {
+        tree_threads[tree_index].join();
+    }
+
+    MergedMoveStatistics merged_moves[MoveSet::max_number_of_moves];
+    ControlledType root_controlled_type = _MergeRootStatistics(merged_moves);
+    TIMED_BLOCK(Move best_move = _SelectBestMergedMove(merged_moves, ArrayCount(merged_moves), root_controlled_type), JobNames::SelectBestChild);
+
+    return best_move;
+}
+
+ControlledType MCSTEnsemble::_MergeRootStatistics(MergedMoveStatistics *merged_moves)
+{
+    for (u32 move_index = 0; move_index < MoveSet::max_number_of_moves; ++move_index)
+    {
+        merged_moves[move_index] = {};
+        merged_moves[move_index].move = Move::MoveFromIndex(move_index);
+    }
+
+    // NOTE(david): the root is always uncontrolled, see MCST::Evaluate
+    ControlledType root_controlled_type = ControlledType::UNCONTROLLED;
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        lock_guard<mutex> tree_lock(_trees[tree_index]->_tree_mutex);
+        Node *root_node = _trees[tree_index]->_root_node;
+        if (root_node == nullptr)
+        {
+            // NOTE(david): the tree hasn't started its first evaluation yet
+            continue ;
+        }
+        assert(root_node->controlled_type == root_controlled_type);
+        NodePool::ChildrenTables *children_nodes = _node_pools[tree_index]->GetChildren(root_node);
+        for (u32 child_index = 0; child_index < children_nodes->number_of_children; ++child_index)
+        {
+            Node *child_node = &children_nodes->children[child_index];
+            if (child_node->is_tombstone)
+            {
+                continue ;
+            }
+            assert(child_node != nullptr && child_node->move_to_get_here.IsValid());
+
+            MergedMoveStatistics *merged_move = &merged_moves[child_node->move_to_get_here.GetIndex()];
+            merged_move->value += child_node->value;
+            merged_move->num_simulations += child_node->num_simulations;
+
+            TerminalType child_terminal_type = child_node->terminal_type;
+            if (child_terminal_type == TerminalType::NOT_TERMINAL)
+            {
+                continue ;
+            }
+            u16 child_terminal_depth;
+            switch (child_terminal_type)
+            {
+                case TerminalType::WINNING: {
+                    child_terminal_depth = _node_pools[tree_index]->GetTerminalDepth(child_node)->winning;
+                } break ;
+                case TerminalType::LOSING: {
+                    child_terminal_depth = _node_pools[tree_index]->GetTerminalDepth(child_node)->losing;
+                } break ;
+                case TerminalType::NEUTRAL: {
+                    child_terminal_depth = _node_pools[tree_index]->GetTerminalDepth(child_node)->neutral;
+                } break ;
+                default: UNREACHABLE_CODE;
+            }
+            // NOTE(david): terminal types aren't always exact (for example when all the children of a node got pruned), so if the trees disagree, go with the one that is worse for the player to move at the root
+            TerminalType worst_terminal_type_for_root = root_controlled_type == ControlledType::CONTROLLED ? TerminalType::LOSING : TerminalType::WINNING;
+            TerminalType best_terminal_type_for_root = root_controlled_type == ControlledType::CONTROLLED ? TerminalType::WINNING : TerminalType::LOSING;
+            if (merged_move->terminal_type == TerminalType::NOT_TERMINAL ||
+                (merged_move->terminal_type != worst_terminal_type_for_root && child_terminal_type == worst_terminal_type_for_root) ||
+                (merged_move->terminal_type == best_terminal_type_for_root && child_terminal_type == TerminalType::NEUTRAL))
+            {
+                merged_move->terminal_type = child_terminal_type;
+                merged_move->terminal_depth = child_terminal_depth;
+            }
+            else if (merged_move->terminal_type == child_terminal_type)
+            {
+                // NOTE(david): keep the depth that the player to move at the root prefers, same as in GetExtremumChildren
+                if (child_terminal_type == best_terminal_type_for_root)
+                {
+                    merged_move->terminal_depth = min(merged_move->terminal_depth, child_terminal_depth);
+                }
+                else
+                {
+                    merged_move->terminal_depth = max(merged_move->terminal_depth, child_terminal_depth);
+                }
+            }
+        }
+    }
+
+    return root_controlled_type;
+}
+
+bool MCSTEnsemble::_IsMergedResultDecisive(void)
+{
+    MergedMoveStatistics merged_moves[MoveSet::max_number_of_moves];
+    ControlledType root_controlled_type = _MergeRootStatistics(merged_moves);
+    TerminalType best_terminal_type_for_root = root_controlled_type == ControlledType::CONTROLLED ? TerminalType::WINNING : TerminalType::LOSING;
+    // NOTE(david): the best merged move is proven to win for the player to move at the root, the other trees can't find anything better
+    // ASSUMPTION(david): the trees that are still searching can still turn it into a worse terminal type, see _MergeRootStatistics, but that's only possible when their terminal types aren't exact
+    for (u32 move_index = 0; move_index < ArrayCount(merged_moves); ++move_index)
+    {
+        if (merged_moves[move_index].num_simulations > 0 && merged_moves[move_index].terminal_type == best_terminal_type_for_root)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Move MCSTEnsemble::_SelectBestMergedMove(const MergedMoveStatistics *merged_moves, u32 number_of_merged_moves, ControlledType root_controlled_type)
+{
+    // NOTE(david): same order of preference as in MCST::SelectBestChild
+    TerminalType terminal_type_preference[4];
+    switch (root_controlled_type)
+    {
+        case ControlledType::CONTROLLED: {
+            terminal_type_preference[0] = TerminalType::WINNING;
+            terminal_type_preference[1] = TerminalType::NEUTRAL;
+            terminal_type_preference[2] = TerminalType::NOT_TERMINAL;
+            terminal_type_preference[3] = TerminalType::LOSING;
+        } break ;
+        case ControlledType::UNCONTROLLED: {
+            terminal_type_preference[0] = TerminalType::LOSING;
+            terminal_type_preference[1] = TerminalType::NEUTRAL;
+            terminal_type_preference[2] = TerminalType::NOT_TERMINAL;
+            terminal_type_preference[3] = TerminalType::WINNING;
+        } break ;
+        default: UNREACHABLE_CODE;
+    }
+    ControlledType child_controlled_type = root_controlled_type == ControlledType::CONTROLLED ? ControlledType::UNCONTROLLED : ControlledType::CONTROLLED;
+
+    u32 root_num_simulations = 0;
+    for (u32 move_index = 0; move_index < number_of_merged_moves; ++move_index)
+    {
+        root_num_simulations += merged_moves[move_index].num_simulations;
+    }
+
+    for (u32 preference_index = 0; preference_index < ArrayCount(terminal_type_preference); ++preference_index)
+    {
+        TerminalType terminal_type = terminal_type_preference[preference_index];
+        const MergedMoveStatistics *best_merged_move = nullptr;
+        r64 best_uct;
+        for (u32 move_index = 0; move_index < number_of_merged_moves; ++move_index)
+        {
+            const MergedMoveStatistics *merged_move = &merged_moves[move_index];
+            if (merged_move->num_simulations == 0 || merged_move->terminal_type != terminal_type)
+            {
+                continue ;
+            }
+            r64 uct = UCT(merged_move->value, merged_move->num_simulations, root_num_simulations, child_controlled_type);
+            if (best_merged_move == nullptr)
+            {
+                best_merged_move = merged_move;
+                best_uct = uct;
+                continue ;
+            }
+            bool is_better;
+            // NOTE(david): same as in GetExtremumChildren, the neutral depths aren't exact, so the draws are told apart by their uct only
+            if (terminal_type == TerminalType::NOT_TERMINAL || terminal_type == TerminalType::NEUTRAL || merged_move->terminal_depth == best_merged_move->terminal_depth)
+            {
+                is_better = uct > best_uct;
+            }
+            else if ((root_controlled_type == ControlledType::CONTROLLED && terminal_type == TerminalType::WINNING) ||
+                     (root_controlled_type == ControlledType::UNCONTROLLED && terminal_type == TerminalType::LOSING))
+            {
+                // NOTE(david): win as fast as possible
+                is_better = merged_move->terminal_depth < best_merged_move->terminal_depth;
+            }
+            else
+            {
+                // NOTE(david): lose as slow as possible
+                is_better = merged_move->terminal_depth > best_merged_move->terminal_depth;
+            }
+            if (is_better)
+            {
+                best_merged_move = merged_move;
+                best_uct = uct;
+            }
+        }
+        if (best_merged_move != nullptr)
+        {
+            return best_merged_move->move;
+        }
+    }
+
+    assert(false && "all children nodes are pruned out, can't select child");
+    Move move;
+    move.Invalidate();
+    return move;
+}
+
+void MCSTEnsemble::AdvanceRoot(Move move_played)
+{
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        _trees[tree_index]->AdvanceRoot(move_played, *_node_pools[tree_index]);
+    }
+}
+
+void MCSTEnsemble::ResetTree(void)
+{
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        _trees[tree_index]->ResetTree(*_node_pools[tree_index]);
+    }
+}
+
+u32 MCSTEnsemble::NumberOfSimulationsRan(void)
+{
+    u32 result = 0;
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        result += _trees[tree_index]->NumberOfSimulationsRan();
+    }
+
+    return result;
+}
+
+u32 MCSTEnsemble::TotalNumberOfFreedNodes(void)
+{
+    u32 result = 0;
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        result += _node_pools[tree_index]->TotalNumberOfFreedNodes();
+    }
+
+    return result;
+}
+
+u32 MCSTEnsemble::CurrentAllocatedNodes(void)
+{
+    u32 result = 0;
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        result += _node_pools[tree_index]->CurrentAllocatedNodes();
+    }
+
+    return result;
+}
+
+u64 MCSTEnsemble::CurrentCommittedMemory(void)
+{
+    u64 result = 0;
+    for (u32 tree_index = 0; tree_index < _number_of_trees; ++tree_index)
+    {
+        result += _node_pools[tree_index]->CurrentCommittedMemory();
+    }
+
+    return result;
+}
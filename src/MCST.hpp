@@ -2,8 +2,10 @@
 #define MCST_HPP
 
 constexpr r64 EXPLORATION_FACTOR = 1.41421356237;
+// NOTE(david): value added against the selecting player for every search thread that is currently simulating below the node
+constexpr r32 VIRTUAL_LOSS = 1.0f;
 
-enum class TerminalType
+enum class TerminalType : u8
 {
     NOT_TERMINAL,
     LOSING,
@@ -13,7 +15,7 @@ enum class TerminalType
     TerminalType_Size
 };
 
-enum class ControlledType
+enum class ControlledType : u8
 {
     NONE,
     CONTROLLED,
@@ -30,37 +32,22 @@ struct TerminalDepth
     Move neutral_continuation;
     u16 winning;
     u16 losing;
+    // NOTE(david): not exact if a draw below has been solved, see SolveEndgame, so it isn't used to choose between the drawn children
     u16 neutral;
 };
 
-struct TerminalInfo
-{
-    TerminalType terminal_type;
-    // TODO(david): this about this and how to implement it, but one problem was propagating back the actual probability, which is not hard (multiply branching until we get to the terminal node), however to make it even more useful, instead of treating all the moves as equal probability, a heuristic evaluation would also need to be stored (or processed dynamically), so that the moves are weighted according to the heuristic value
-    // r32 p_of_terminal_outcome; // NOTE(david): probability that the outcomes from the Node results in a terminal outcome, useful information to determine best next move
-                               // probability of terminal outcome for node = (heuristic weight for node / number of node's children / sum of heuristic weights for node) + sum of probability of terminal outcomes for node's children
-    // u16 terminal_depth; // NOTE(david): this refers to the max depth when the node first found to be terminal, which then propagates back to find in how many moves does it take to reach terminal game state, can be useful to choose the next move that wins in the least moves and loses in the most moves, also based on the depth, extra weighted info could be propagated up the root, that is a likelyhood of the outcome: for example if there are 20 of terminally losing nodes scattered down the tree at depth 10, this could be weighted in to the starting move as 20 * 1 / 10 chance of losing (the reciprocal function is not the best used here, it should be a function that accounts for the branching)
-    TerminalDepth terminal_depth;
-};
-
-template <u32 MoveSize>
-struct MoveSequence
-{
-    Move moves[MoveSize];
-    u32 moves_left;
-
-    void AddMove(Move move);
-    Move PopMoveAtIndex(u32 move_index);
-};
-
 struct NodePool;
 
 // NOTE(david): must be signed
 typedef i32 NodeIndex;
+// NOTE(david): only the data needed to select a child is stored in the node, the rest of the data is stored by NodePool in separate arrays indexed by the node's index, so that more nodes fit in a cache line during selection
 struct Node
 {
     r32 value;
+    // NOTE(david): includes the virtual losses
     u32 num_simulations;
+    // NOTE(david): number of search threads that have selected a node from this node's subtree and haven't backpropagated their simulation yet
+    u32 num_virtual_losses;
 
     // NOTE(david): unique index to the child table as well as for the node
     // TODO(david): maybe store the actual pointer to the children table for the same reasons as to store the parent pointer instead of the index of the parent
@@ -68,12 +55,22 @@ struct Node
     // NOTE(david): maybe it makes sense to store the parent as a pointer to give up some extra space in order to avoid the extra lookup through NodePool
     Node *parent;
 
-    ControlledType controlled_type;
-    TerminalInfo terminal_info;
-
+    // NOTE(david): needed during selection to remove the already expanded moves from the legal moves
     Move move_to_get_here;
 
+    // NOTE(david): entry of the node's position in the transposition table, which holds the statistics shared by every node of the same position
+    u32 transposition_entry_index;
+
     u16 depth;
+    // NOTE(david): the node has been pruned or moved to its own block, but its place is kept as the children of its parent are stored contiguously
+    bool is_tombstone;
+    ControlledType controlled_type;
+    // TODO(david): this about this and how to implement it, but one problem was propagating back the actual probability, which is not hard (multiply branching until we get to the terminal node), however to make it even more useful, instead of treating all the moves as equal probability, a heuristic evaluation would also need to be stored (or processed dynamically), so that the moves are weighted according to the heuristic value
+    // r32 p_of_terminal_outcome; // NOTE(david): probability that the outcomes from the Node results in a terminal outcome, useful information to determine best next move
+                               // probability of terminal outcome for node = (heuristic weight for node / number of node's children / sum of heuristic weights for node) + sum of probability of terminal outcomes for node's children
+    // u16 terminal_depth; // NOTE(david): this refers to the max depth when the node first found to be terminal, which then propagates back to find in how many moves does it take to reach terminal game state, can be useful to choose the next move that wins in the least moves and loses in the most moves, also based on the depth, extra weighted info could be propagated up the root, that is a likelyhood of the outcome: for example if there are 20 of terminally losing nodes scattered down the tree at depth 10, this could be weighted in to the starting move as 20 * 1 / 10 chance of losing (the reciprocal function is not the best used here, it should be a function that accounts for the branching)
+    // NOTE(david): the terminal depth is cold data, see NodePool::GetTerminalDepth
+    TerminalType terminal_type;
 
     // TODO(david): change this to ChangeTerminalType maybe as they are kind of coupled? Terminal Depth only has to be updated when the terminal type of a node changes from not terminal to terminal, in which case this should be recursing back to root, in which case it'd only have to be called once during backpropagation
     // NOTE(david): returns terminal type if parent's terminal type's depth has been changed, as that signals that the grandparent's terminal depth might also need to be updated by its children's terminal depth
@@ -87,78 +84,215 @@ struct SimulationResult
 {
     r32 value;
     u32 num_simulations;
+    // NOTE(david): set if the game is over at the simulated node or it has been solved, so the simulated node itself is terminal
+    TerminalType terminal_type;
+    // NOTE(david): number of moves from the simulated node to the end of the game, non-zero if the node has been solved, only an upper bound for a draw
+    u16 plies_to_terminal;
+};
+
+constexpr u32 max_number_of_search_threads = 64;
+// NOTE(david): the children of a node are allocated together, so a block of nodes is never larger than the number of moves
+constexpr u32 max_children_block_size = MoveSet::max_number_of_moves;
+
+// NOTE(david): the same position is reached by many move orders, each of them has its own node in the tree, but the nodes of the same position share their statistics through the table, so what is learned on one path is used on all the others
+// the tree isn't merged into a graph, the transposed nodes keep their own subtrees, so this doesn't save any nodes, the table is only a cache of statistics for the selection
+// NOTE(david): the parent count of the uct is the sum of the shared counts of the children, so that the counts of the children always add up to it
+// NOTE(david): open addressing with linear probing, the entries are never moved, an entry holds the sum of the statistics of the nodes that refer to it, so the statistics of a node are taken out of its entry when the node is freed
+// ASSUMPTION(david): only used under the tree lock
+struct TranspositionTable
+{
+    struct Entry
+    {
+        u64 key;
+        r32 value;
+        u32 num_simulations;
+        // NOTE(david): number of nodes that refer to the entry
+        u32 number_of_nodes;
+        // NOTE(david): the entry is only in use if it's from the current generation
+        u32 generation;
+    };
+
+    static constexpr u32 invalid_entry_index = (u32)-1;
+    static constexpr u32 max_probe_length = 16;
+
+    Entry *_entries;
+    u32 _size_mask;
+    // NOTE(david): advanced on every clear, so that the table doesn't have to be zeroed
+    u32 _generation;
+
+    TranspositionTable(u64 memory_ceiling_in_bytes);
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable &other) = delete;
+    const TranspositionTable &operator=(const TranspositionTable &other) = delete;
+
+    // NOTE(david): returns invalid_entry_index if the probed entries are all in use, in which case the node doesn't share its statistics
+    u32 AcquireEntry(u64 key);
+    // NOTE(david): value and num_simulations are the statistics of the node that releases the entry
+    void ReleaseEntry(u32 entry_index, r32 value, u32 num_simulations);
+    Entry *GetEntry(u32 entry_index);
+    void Clear(void);
+    u64 Size(void);
 };
 
-// TODO(david): reallocation of more nodes if the nodepool is full?
+// NOTE(david): nodes are allocated in blocks, the children of a node are stored contiguously in one block sized to the number of legal moves from the node
+// NOTE(david): blocks are taken from a free list per block size, or bumped off the never used nodes
+// ASSUMPTION(david): the pool is only used by one thread at a time, during the search that's the thread holding the tree lock, the trees of an ensemble have their own pools
+// NOTE(david): free blocks are only split on allocation, the adjacent ones are merged back by CoalesceFreeBlocks, otherwise the pool fragments into blocks that are too small for the larger children blocks
+// NOTE(david): the pool grows on demand in segments up to its memory ceiling, the segments are never moved or freed before the pool is destroyed, so node addresses are stable
 struct NodePool
 {
-    const NodeIndex _number_of_nodes_allocated;
+    static constexpr NodeIndex invalid_node_index = -1;
+    static constexpr NodeIndex node_segment_size = 4096;
 
-    Node *_nodes;
+    // NOTE(david): the nodes from here on have never been used, a block never spans two segments, so the rest of a segment that is too small for a block is pushed to the free lists
     NodeIndex _available_node_index;
+    // NOTE(david): first free block of each block size, the next one is stored in NodeSegment::free_blocks
+    NodeIndex _free_blocks_heads[max_children_block_size + 1];
 
-    NodeIndex *_free_nodes;
-    NodeIndex _free_nodes_index;
+    u32 _number_of_allocated_nodes;
+    u32 _number_of_freed_nodes;
+    // NOTE(david): size of the last block that couldn't be allocated, 0 if there wasn't one since it was reset
+    u32 _failed_block_size;
 
-    // NOTE(david): shouldn't be more than the max action space at any point
-    // TODO(david): should also be dynamic, as depending on the state, the action space is vastly different in size
-    // TODO(david): actually this could be limited in size, and with pruning existing nodes (based on some upper confidence bound) can be updated with new ones
-    // NOTE(david): the children nodes are stored randomly
-    static constexpr u32 allowed_branching_factor = 3;
     struct ChildrenTables
     {
-        Node *children[allowed_branching_factor];
-        u32 number_of_children;
+        // NOTE(david): block of nodes allocated on the first expansion, the first number_of_children nodes are expanded in the order of their move indices, the rest are not initialized yet
+        Node *children;
+        u16 number_of_children;
+        u16 capacity;
         // NOTE(david): since 0 index is a legal move, this starts at -1
         i32 highest_move_index;
     };
 
-    ChildrenTables *_move_to_node_tables;
+    struct NodeSegment
+    {
+        Node nodes[node_segment_size];
+        ChildrenTables children_tables[node_segment_size];
+        // NOTE(david): cold data of the nodes, only needed once a node is terminal
+        TerminalDepth terminal_depths[node_segment_size];
+        // NOTE(david): next block in the free list for the first node of a free block
+        NodeIndex free_blocks[node_segment_size];
+    };
 
-    // TODO(david): count the number of allocated and freed nodes
-    u32 _total_number_of_freed_nodes;
+    NodeSegment **_segments;
+    u32 _max_number_of_segments;
+    NodeIndex _max_number_of_nodes;
+
+    // NOTE(david): share of the memory ceiling that is taken by the transposition table
+    static constexpr u32 transposition_table_memory_divisor = 16;
+    TranspositionTable _transposition_table;
 public:
-    NodePool(NodeIndex number_of_nodes_to_allocate);
+    NodePool(u64 memory_ceiling_in_bytes);
     ~NodePool();
 
-    Node *AllocateNode(Node *parent);
+    // NOTE(david): the position key is the hash of the position, nodes with the same key share their statistics
+    Node *AllocateRootNode(u64 position_key);
+    // NOTE(david): frees the subtree of the node, a root is freed entirely, but any other node stays in its parent's children block as a tombstone
     void FreeNode(Node *node);
-
-    void AddChild(Node *node, Node *child, Move move);
+    // NOTE(david): frees the subtree below the node, so that the node becomes a leaf again with its statistics kept
+    void FreeChildren(Node *node);
+    // NOTE(david): moves the node out of its parent's children block into its own block, the node becomes the root of its own subtree and its old place becomes a tombstone
+    // NOTE(david): returns nullptr if the pool is out of nodes, in which case nothing is changed
+    Node *DetachNode(Node *node);
+
+    // NOTE(david): expands the next child of the node, the children block is allocated on the first expansion with room for all the legal moves from the node
+    // NOTE(david): returns nullptr if the pool is out of nodes
+    Node *AddChild(Node *node, Move move, u32 number_of_legal_moves, u64 position_key);
     ChildrenTables *GetChildren(Node *node);
+    TerminalDepth *GetTerminalDepth(Node *node);
+    // NOTE(david): returns nullptr if the node doesn't share its statistics
+    TranspositionTable::Entry *GetTranspositionEntry(Node *node);
 
     void Clear();
     void ClearChildTable(u32 table_index);
 
     u32 TotalNumberOfFreedNodes(void);
     u32 CurrentAllocatedNodes(void);
+    u64 CurrentCommittedMemory(void);
+    NodeIndex MaxNumberOfNodes(void);
+
+    u32 FailedBlockSize(void);
+    void ResetFailedBlockSize(void);
+    bool CanAllocateBlock(u32 block_size);
+
+    // NOTE(david): merges the adjacent free blocks into blocks of the largest size
+    void CoalesceFreeBlocks(void);
 private:
     void FreeNodeHelper(Node *node);
+
+    void _ClearFreeBlocks(void);
+    // NOTE(david): returns nullptr if the pool is out of nodes
+    Node *_AllocateBlock(u32 block_size);
+    NodeIndex _PopFreeBlock(u32 block_size);
+    NodeIndex _BumpBlock(u32 block_size);
+    bool _CanBumpBlock(u32 block_size);
+    bool _AllocateSegment(u32 segment_index);
+    NodeSegment *_GetSegment(NodeIndex node_index);
+    void _PushFreeBlock(NodeIndex block_index, u32 block_size);
+    void _MarkFreeBlocks(NodeIndex first_block_index, u32 block_size, vector<u64> &is_free_node);
 };
 
-constexpr u32 max_move_chain_depth = 32;
-using SimulateFromState = function<SimulationResult(const MoveSequence<max_move_chain_depth> &move_chain_from_world_state, const GameState &game_state, Node *node, const NodePool &node_pool)>;
+// NOTE(david): doesn't have access to the tree, as it's called without holding the tree lock
+// the simulation can play on the leaf state, but it has to take back its moves before returning
+using SimulateFromState = function<SimulationResult(GameState &leaf_game_state, Player player_to_move_at_root)>;
 using TerminationPredicate = function<bool(bool found_perfect_move)>;
 
 class MCST
 {
 private:
+    friend class MCSTEnsemble;
+
     Node *_root_node;
+    // NOTE(david): if set, the search tree is kept between evaluations and the root is advanced by the moves played, otherwise each evaluation starts from an empty tree
+    bool _reuse_tree;
+
+    // NOTE(david): the threads of a tree share it, but only their simulations run at the same time, the selection, expansion, backpropagation, pruning and eviction of every thread are done under the tree lock, virtual loss is used to spread the simulations across the tree
+    // ASSUMPTION(david): this isn't parallel tree search, the node statistics are plain fields that are only touched under the lock, so the threads only help while the simulations take most of the time, MCSTEnsemble with one thread per tree is the mode that scales with the number of threads
+    u32 _number_of_threads;
+    mutex _tree_mutex;
+
+    // NOTE(david): memory-bounded search, once the node pool is close to its ceiling the least visited subtrees are collapsed into their roots, so the search can keep expanding
+    bool _evict_cold_subtrees;
+    static constexpr r32 eviction_high_watermark = 0.9f;
+    static constexpr r32 eviction_low_watermark = 0.7f;
+    // NOTE(david): a pass that is started by a failed allocation frees at least the min share of the pool, so that the next pass isn't needed right away, and at most the max share, unless merging the free blocks is enough for the failed allocation
+    static constexpr r32 eviction_min_freed_share_after_failed_allocation = 0.02f;
+    static constexpr r32 eviction_max_freed_share_after_failed_allocation = 0.1f;
+    // NOTE(david): no pass is started before the root reaches this many simulations, set after a pass that didn't free anything
+    u32 _next_eviction_num_simulations;
+
+    // NOTE(david): search thread n draws from random stream _first_random_stream_index + n of the family _number_of_evaluations, so with the same seed, number of threads and iterations a single threaded tree is searched the same way every time
+    // the order in which the threads of the same tree take the tree lock still differs from run to run
+    u32 _first_random_stream_index;
+    u32 _number_of_evaluations;
+
+    u32 _debug_tree_id;
 
 public:
-    MCST() = default;
+    MCST(bool reuse_tree = false, u32 number_of_threads = 1, bool evict_cold_subtrees = false);
     MCST(const MCST &other) = delete;
     const MCST &operator=(const MCST &other) = delete;
 
     Move Evaluate(const MoveSet &legal_moves_at_root_node, TerminationPredicate terminate_condition_fn, SimulateFromState simulation_from_state, NodePool &node_pool, const GameState &game_state);
 
+    // NOTE(david): has to be called for every move that is played (by either player) in order for the reused tree to stay in sync with the game state
+    void AdvanceRoot(Move move_played, NodePool &node_pool);
+    // NOTE(david): drops the reused tree, for example when a new game is started
+    void ResetTree(NodePool &node_pool);
+
+    // NOTE(david): only used to tell apart the debug output of multiple trees
+    void SetDebugTreeId(u32 debug_tree_id);
+    // NOTE(david): the trees that search at the same time need to use different random streams
+    void SetFirstRandomStreamIndex(u32 first_random_stream_index);
+
     u32 NumberOfSimulationsRan(void);
 
 private:
     struct SelectionResult
     {
         Node *selected_node;
-        MoveSequence<max_move_chain_depth> movesequence_from_position;
+        // NOTE(david): the state of the selected node, built by making the moves of the selected path on the way down
+        GameState leaf_game_state;
     };
 
     struct ExtremumChildren
@@ -174,18 +308,66 @@ private:
 
         Node *best_neutral;
         Node *worst_neutral;
-
-        u32 condition_checked_nodes_on_their_simulation_count;
     };
-    ExtremumChildren GetExtremumChildren(Node *from_node, NodePool &node_pool, u32 min_simulation_confidence_cycle_treshold = 0);
+    ExtremumChildren GetExtremumChildren(Node *from_node, NodePool &node_pool);
 
     Node *SelectBestChild(Node *from_node, NodePool &node_pool);
 
-    SelectionResult _Selection(const MoveSet &legal_moveset_at_root_node, NodePool &node_pool);
-    Node *_SelectChild(Node *from_node, const MoveSet &legal_moves_from_node, bool focus_on_lowest_utc_to_prune, NodePool &node_pool);
-    Node *_Expansion(Node *from_node, NodePool &node_pool);
+    void _SearchWorker(u32 worker_index, const TerminationPredicate &termination_predicate, const SimulateFromState &simulation_from_state, NodePool &node_pool, const GameState &game_state);
+    void _AddVirtualLoss(Node *selected_node, NodePool &node_pool);
+    void _RemoveVirtualLoss(Node *selected_node, NodePool &node_pool);
+    void _ApplySimulationResult(Node *simulated_node, NodePool &node_pool, SimulationResult simulation_result);
+
+    SelectionResult _Selection(const GameState &game_state, NodePool &node_pool);
+    Node *_SelectChild(Node *from_node, const GameState &game_state_at_node, bool focus_on_lowest_utc_to_prune, NodePool &node_pool);
+    Node *_Expansion(Node *from_node, Move move, u32 number_of_legal_moves, u64 position_key, NodePool &node_pool);
     void _BackPropagate(Node *from_node, NodePool &node_pool, SimulationResult simulation_result);
     void PruneNode(Node *from_node, NodePool &node_pool);
+    // NOTE(david): failed_block_size is 0 if the pass isn't started by a failed allocation, returns the number of freed nodes
+    u32 _EvictColdSubtrees(NodePool &node_pool, u32 failed_block_size);
+    void RebaseDepth(Node *from_node, u16 depth_offset, NodePool &node_pool);
+};
+
+// NOTE(david): root parallelization, every tree has its own NodePool and is searched by its own threads without sharing anything with the other trees, the statistics of the root children are merged after the search to select the move
+class MCSTEnsemble
+{
+private:
+    MCST *_trees[max_number_of_search_threads];
+    NodePool *_node_pools[max_number_of_search_threads];
+    u32 _number_of_trees;
+
+    struct MergedMoveStatistics
+    {
+        Move move;
+        r64 value;
+        u32 num_simulations;
+        TerminalType terminal_type;
+        u16 terminal_depth;
+    };
+
+public:
+    MCSTEnsemble(u32 number_of_trees, u32 number_of_threads_per_tree, u64 memory_ceiling_in_bytes, bool reuse_tree = false, bool evict_cold_subtrees = false);
+    ~MCSTEnsemble();
+    MCSTEnsemble(const MCSTEnsemble &other) = delete;
+    const MCSTEnsemble &operator=(const MCSTEnsemble &other) = delete;
+
+    Move Evaluate(const MoveSet &legal_moves_at_root_node, TerminationPredicate terminate_condition_fn, SimulateFromState simulation_from_state, const GameState &game_state);
+
+    void AdvanceRoot(Move move_played);
+    void ResetTree(void);
+
+    u32 NumberOfSimulationsRan(void);
+    u32 TotalNumberOfFreedNodes(void);
+    u32 CurrentAllocatedNodes(void);
+    u64 CurrentCommittedMemory(void);
+
+private:
+    // NOTE(david): the statistics of the children of the roots are summed up per move, every tree is locked while its root is read, so this can be called during the search
+    // returns the controlled type of the roots
+    ControlledType _MergeRootStatistics(MergedMoveStatistics *merged_moves);
+    // NOTE(david): true if the merged result has a move that is proven to win for the player to move at the root
+    bool _IsMergedResultDecisive(void);
+    static Move _SelectBestMergedMove(const MergedMoveStatistics *merged_moves, u32 number_of_merged_moves, ControlledType root_controlled_type);
 };
 
 #endif
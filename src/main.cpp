@@ -1,25 +1,65 @@
 #include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
 #if 0
 # define NDEBUG
 #endif
-#include <random>
 #include <stdexcept>
 #include <cassert>
 #include <functional>
 #include <sstream>
+#include <vector>
 #include "types.hpp"
 #include "raylib.h"
 #include <intrin.h>
 
 using namespace std;
 
-constexpr u32 GRID_DIM_ROW = 5;
-constexpr u32 GRID_DIM_COL = 5;
-constexpr u32 ConnectToWinCount = 4;
+// NOTE(david): board geometry of a variant of the game, the game rules are templated on it, so every variant gets its own fully specialized code
+template <u32 Rows, u32 Cols, u32 ConnectToWinCount>
+struct GameConfig
+{
+    static constexpr u32 rows = Rows;
+    static constexpr u32 cols = Cols;
+    static constexpr u32 connect_to_win_count = ConnectToWinCount;
+    static constexpr u32 number_of_grids = Rows * Cols;
+
+    static_assert(Rows > 0 && Cols > 0, "the board can't be empty");
+    static_assert(ConnectToWinCount > 0 && ConnectToWinCount <= Rows && ConnectToWinCount <= Cols, "a winning line has to fit on the board");
+};
+// NOTE(david): the variant that is played, the search and the window are instantiated for it
+// the variant is picked at compile time, the other variants are only checked by DEBUG_CHECK_GAME_RULES, they aren't playable without changing this
+using ActiveGameConfig = GameConfig<5, 5, 4>;
 constexpr std::chrono::milliseconds max_evaluation_time = 15000ms;
+// NOTE(david): keep the subtree of the move played and its reply between evaluations
+constexpr bool reuse_search_tree = true;
+// NOTE(david): number of search threads, 0 means one for each hardware thread
+constexpr u32 number_of_search_threads = 0;
+// NOTE(david): if set, every search thread has its own tree and the root statistics are merged after the search, otherwise all the threads share one tree and only their simulations run at the same time
+// the shared tree doesn't scale, the selection, expansion and backpropagation of every thread is serialized by the single tree lock
+// with the same seed and number of iterations per tree, root parallel search builds the same trees on every run, the shared tree with more than one thread doesn't, as the order in which the threads take the tree lock changes from run to run
+constexpr bool root_parallel_search = true;
+// NOTE(david): number of playouts run from each selected leaf, if more than one, they run at the same time on the playout worker pool
+constexpr u32 number_of_leaf_playouts = 1;
+// NOTE(david): number of playout worker threads, 0 means one less than the number of hardware threads
+constexpr u32 number_of_playout_threads = 0;
+// NOTE(david): once the node pool gets close to its memory ceiling, collapse the least visited subtrees instead of stopping the expansion
+constexpr bool evict_cold_subtrees = true;
+// NOTE(david): if set, number_of_rollout_lanes playouts are run side by side from each selected leaf instead of a single one, see RolloutLanes for what is batched
+constexpr bool lane_parallel_rollouts = false;
+constexpr u32 number_of_rollout_lanes = 16;
+// NOTE(david): if set, the rollouts take a winning move if there is one, otherwise block the immediate win of the opponent, and only move randomly if neither is possible
+constexpr bool heavy_rollout_policy = false;
+// NOTE(david): if set, the search treats a position as a draw as soon as neither player can complete a line anymore, instead of playing on until the board is full
+constexpr bool detect_dead_positions = true;
+// NOTE(david): leaves with at most this many empty grids are solved exactly instead of simulated, 0 turns the endgame solver off
+constexpr u32 endgame_solver_empty_grids_threshold = 10;
 
 #if 1
 # define DEBUG_TIME
@@ -29,6 +69,14 @@ constexpr std::chrono::milliseconds max_evaluation_time = 15000ms;
 # define DEBUG_WRITE_OUT
 #endif
 
+#if 0
+# define DEBUG_CHECK_GAME_RULES
+#endif
+
+#if 0
+# define DEBUG_CHECK_PLAYOUT_WORKER_POOL
+#endif
+
 #if 0
 # define DEBUG_WRITE_OUT_SIM_RESULT
 #endif
@@ -52,15 +100,13 @@ enum class JobNames
     Simulation,
     BackPropagate,
     SelectBestChild,
-    DetermineGameOutcomeDuringSimulation,
-    DetermineGameOutcomeAfterMoveDuringSimulation,
-    DeleteMoveDuringSimulation,
-    GetPlayerDuringSimulation,
-    AddPlayerDuringSimulation,
-    InitializeRandomNumberSequenceDuringSimulation,
+    MakeMoveDuringSimulation,
     GetRandomNumberDuringSimulation,
-    PopMoveAtIndexDuringSimulation,
+    GetMoveAtIndexDuringSimulation,
+    GetForcedMovesDuringSimulation,
+    SolveEndgame,
     SimulationFromPositionOnce,
+    RolloutLanes,
 
     JobNamesSize
 };
@@ -78,14 +124,28 @@ struct TimedBlocks
     } timed_results[JobNames::JobNamesSize];
 };
 static TimedBlocks g_timed_blocks = {};
+// NOTE(david): each thread times its own jobs, which are merged into g_timed_blocks when the thread is done
+static thread_local TimedBlocks g_thread_timed_blocks = {};
+static mutex g_timed_blocks_mutex;
 
 constexpr r64 processor_clock_cycles_per_second = 2.11 * 1000000000;
 # define TIMED_BLOCK(job_expression, scoped_job_name) \
-    assert((u32)scoped_job_name < ArrayCount(g_timed_blocks.timed_results));\
-    g_timed_blocks.timed_results[(u32)scoped_job_name].unique_clock = __rdtsc(); \
+    assert((u32)scoped_job_name < ArrayCount(g_thread_timed_blocks.timed_results));\
+    g_thread_timed_blocks.timed_results[(u32)scoped_job_name].unique_clock = __rdtsc(); \
     job_expression; \
-    g_timed_blocks.timed_results[(u32)scoped_job_name].total_elapsed_number_of_clock_cycles += __rdtsc() - g_timed_blocks.timed_results[(u32)scoped_job_name].unique_clock;\
-    g_timed_blocks.timed_results[(u32)scoped_job_name].counter_since_last_clear++;
+    g_thread_timed_blocks.timed_results[(u32)scoped_job_name].total_elapsed_number_of_clock_cycles += __rdtsc() - g_thread_timed_blocks.timed_results[(u32)scoped_job_name].unique_clock;\
+    g_thread_timed_blocks.timed_results[(u32)scoped_job_name].counter_since_last_clear++;
+
+# define MERGE_THREAD_JOBS \
+    {\
+        lock_guard<mutex> timed_blocks_lock(g_timed_blocks_mutex);\
+        for (u32 job_index = 0; job_index < ArrayCount(g_timed_blocks.timed_results); ++job_index)\
+        {\
+            g_timed_blocks.timed_results[job_index].total_elapsed_number_of_clock_cycles += g_thread_timed_blocks.timed_results[job_index].total_elapsed_number_of_clock_cycles;\
+            g_timed_blocks.timed_results[job_index].counter_since_last_clear += g_thread_timed_blocks.timed_results[job_index].counter_since_last_clear;\
+        }\
+        memset(&g_thread_timed_blocks, 0, sizeof(g_thread_timed_blocks));\
+    }
 
 string NumberToPrettyFormat(string str)
 {
@@ -145,15 +205,13 @@ string NumberToPrettyFormat(r64 number)
     NONAPI_LOG_JOB_NON_SCOPED(os, Simulation);\
     NONAPI_LOG_JOB_NON_SCOPED(os, BackPropagate);\
     NONAPI_LOG_JOB_NON_SCOPED(os, SelectBestChild);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, DetermineGameOutcomeDuringSimulation);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, DetermineGameOutcomeAfterMoveDuringSimulation);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, DeleteMoveDuringSimulation);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, GetPlayerDuringSimulation);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, AddPlayerDuringSimulation);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, InitializeRandomNumberSequenceDuringSimulation);\
+    NONAPI_LOG_JOB_NON_SCOPED(os, MakeMoveDuringSimulation);\
     NONAPI_LOG_JOB_NON_SCOPED(os, GetRandomNumberDuringSimulation);\
-    NONAPI_LOG_JOB_NON_SCOPED(os, PopMoveAtIndexDuringSimulation);\
+    NONAPI_LOG_JOB_NON_SCOPED(os, GetMoveAtIndexDuringSimulation);\
+    NONAPI_LOG_JOB_NON_SCOPED(os, GetForcedMovesDuringSimulation);\
+    NONAPI_LOG_JOB_NON_SCOPED(os, SolveEndgame);\
     NONAPI_LOG_JOB_NON_SCOPED(os, SimulationFromPositionOnce);\
+    NONAPI_LOG_JOB_NON_SCOPED(os, RolloutLanes);\
     LOG(os, string(181, '-'));\
     os.flags(old_os_flags);
 # define LOG_JOB(os, job_name) \
@@ -169,6 +227,7 @@ string NumberToPrettyFormat(r64 number)
 # define LOG_JOBS(os)
 # define LOG_JOB(os, job_name)
 # define CLEAR_JOBS
+# define MERGE_THREAD_JOBS
 #endif
 
 #if defined(DEBUG_WRITE_OUT)
@@ -183,11 +242,178 @@ string NumberToPrettyFormat(r64 number)
 # define WRITE_OUTVN(os, msg)
 #endif
 
-static std::mt19937 gen;
+// NOTE(david): used to generate tables of random keys and to seed the random number generators
+static constexpr u64 SplitMix64(u64 *state)
+{
+    u64 result = (*state += 0x9e3779b97f4a7c15ull);
+    result = (result ^ (result >> 30)) * 0xbf58476d1ce4e5b9ull;
+    result = (result ^ (result >> 27)) * 0x94d049bb133111ebull;
+    return result ^ (result >> 31);
+}
+
+static inline u64 RotateLeft(u64 x, u32 k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// NOTE(david): xoshiro256** by Blackman and Vigna, 256 bits of state, a few cycles per number
+struct Xoshiro256StarStar
+{
+    u64 state[4];
+
+    void Seed(u64 seed);
+    u32  NextU32(void);
+    // NOTE(david): advances the state by 2^128 numbers, so the generators jumped a different number of times from the same seed never overlap
+    void Jump(void);
+};
+
+void Xoshiro256StarStar::Seed(u64 seed)
+{
+    // NOTE(david): the state can't be all zeros, SplitMix64 never gives 4 zeros in a row
+    for (u32 state_index = 0; state_index < ArrayCount(state); ++state_index)
+    {
+        state[state_index] = SplitMix64(&seed);
+    }
+}
+
+u32 Xoshiro256StarStar::NextU32(void)
+{
+    u64 result = RotateLeft(state[1] * 5, 7) * 9;
+    u64 t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = RotateLeft(state[3], 45);
+
+    // NOTE(david): the upper bits are the better ones
+    return (u32)(result >> 32);
+}
+
+void Xoshiro256StarStar::Jump(void)
+{
+    static constexpr u64 jump_polynomial[4] = { 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull };
+    u64 jumped_state[4] = {};
+    for (u32 polynomial_index = 0; polynomial_index < ArrayCount(jump_polynomial); ++polynomial_index)
+    {
+        for (u32 bit_index = 0; bit_index < 64; ++bit_index)
+        {
+            if (jump_polynomial[polynomial_index] & ((u64)1 << bit_index))
+            {
+                for (u32 state_index = 0; state_index < ArrayCount(state); ++state_index)
+                {
+                    jumped_state[state_index] ^= state[state_index];
+                }
+            }
+            NextU32();
+        }
+    }
+    for (u32 state_index = 0; state_index < ArrayCount(state); ++state_index)
+    {
+        state[state_index] = jumped_state[state_index];
+    }
+}
+
+// NOTE(david): PCG-XSH-RR by O'Neill, 64 bits of state, an alternative of Xoshiro256StarStar with the same interface
+struct Pcg32
+{
+    u64 state;
+
+    void Seed(u64 seed);
+    u32  NextU32(void);
+    // NOTE(david): advances the state by 2^48 numbers
+    void Jump(void);
+};
+
+void Pcg32::Seed(u64 seed)
+{
+    state = SplitMix64(&seed);
+}
+
+u32 Pcg32::NextU32(void)
+{
+    u64 old_state = state;
+    state = old_state * 6364136223846793005ull + 1442695040888963407ull;
+    u32 xorshifted = (u32)(((old_state >> 18) ^ old_state) >> 27);
+    u32 rotation = (u32)(old_state >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((0u - rotation) & 31));
+}
+
+void Pcg32::Jump(void)
+{
+    // NOTE(david): the step of the LCG is composed with itself by squaring, the steps that make up the distance are accumulated
+    u64 accumulated_multiplier = 1;
+    u64 accumulated_increment = 0;
+    u64 current_multiplier = 6364136223846793005ull;
+    u64 current_increment = 1442695040888963407ull;
+    for (u64 distance = (u64)1 << 48; distance > 0; distance >>= 1)
+    {
+        if (distance & 1)
+        {
+            accumulated_multiplier *= current_multiplier;
+            accumulated_increment = accumulated_increment * current_multiplier + current_increment;
+        }
+        current_increment = (current_multiplier + 1) * current_increment;
+        current_multiplier *= current_multiplier;
+    }
+    state = accumulated_multiplier * state + accumulated_increment;
+}
+
+// NOTE(david): the generator used by GetRandomNumber, anything with Seed, NextU32 and Jump can be plugged in
+using RandomNumberGenerator = Xoshiro256StarStar;
+
+// NOTE(david): uniform number in [0, bound), Lemire's nearly divisionless method, the multiplication maps the 32 bit number to the range, the division is only needed to reject the few numbers that would make the result biased
+template <typename Generator>
+static inline u32 GetBoundedRandomNumber(Generator *generator, u32 bound)
+{
+    assert(bound > 0);
+    u64 product = (u64)generator->NextU32() * bound;
+    u32 low_bits = (u32)product;
+    if (low_bits < bound)
+    {
+        u32 threshold = (0u - bound) % bound;
+        while (low_bits < threshold)
+        {
+            product = (u64)generator->NextU32() * bound;
+            low_bits = (u32)product;
+        }
+    }
+
+    return (u32)(product >> 32);
+}
+
+// NOTE(david): every thread draws from its own stream of random numbers, the streams are derived from the master seed g_random_seed
+// the streams of a family are the generator seeded by the master seed and the family, jumped ahead by the index of the stream, so they never overlap
+static u64 g_random_seed;
+static thread_local RandomNumberGenerator g_random_number_generator;
+static thread_local bool g_is_random_number_generator_seeded;
+// NOTE(david): family of the streams of the threads that didn't choose one, they are handed out in the order the threads first ask for a random number, so they aren't reproducible
+constexpr u64 unassigned_random_stream_family = ~(u64)0;
+static atomic<u32> g_number_of_unassigned_random_streams;
+
+// NOTE(david): the calling thread draws its random numbers from the stream from now on, the same family and index always give the same numbers for the same master seed
+// ASSUMPTION(david): no other thread uses the same stream at the same time
+void SetRandomStream(u64 stream_family, u32 stream_index)
+{
+    u64 family_seed = stream_family;
+    g_random_number_generator.Seed(g_random_seed ^ SplitMix64(&family_seed));
+    for (u32 jump_index = 0; jump_index < stream_index; ++jump_index)
+    {
+        g_random_number_generator.Jump();
+    }
+    g_is_random_number_generator_seeded = true;
+}
+
 i32 GetRandomNumber(i32 min, i32 max)
 {
-    std::uniform_int_distribution<> dis(min, max);
-    return dis(gen);
+    assert(min <= max);
+    if (g_is_random_number_generator_seeded == false)
+    {
+        SetRandomStream(unassigned_random_stream_family, g_number_of_unassigned_random_streams++);
+    }
+
+    return min + (i32)GetBoundedRandomNumber(&g_random_number_generator, (u32)(max - min) + 1);
 }
 
 enum class Player
@@ -197,64 +423,103 @@ enum class Player
     NONE
 };
 
-struct Move
+template <typename Config>
+struct BasicMove
 {
-    // TODO(david): 1 param uniquely identifies the move, no need for two
-    // NOTE(david): first param
-    u32 row;
-    // NOTE(david): second param
-    u32 col;
+    static_assert(Config::number_of_grids < 256, "the move index doesn't fit into a byte");
+
+    // NOTE(david): row * cols + col, the row and col are derived from it on demand, number_of_grids if the move is invalid
+    u8 index;
 
     bool IsValid(void) const;
     void Invalidate(void);
     u32 GetIndex(void) const;
+    u32 GetRow(void) const;
+    u32 GetCol(void) const;
 
-    static Move MoveFromIndex(u32 move_index);
+    static BasicMove MoveFromIndex(u32 move_index);
+    static BasicMove MoveFromRowCol(u32 row, u32 col);
 };
 
-Move Move::MoveFromIndex(u32 move_index)
+template <typename Config>
+BasicMove<Config> BasicMove<Config>::MoveFromIndex(u32 move_index)
+{
+    BasicMove result = {};
+
+    result.index = (u8)(move_index < Config::number_of_grids ? move_index : Config::number_of_grids);
+
+    return result;
+}
+
+template <typename Config>
+BasicMove<Config> BasicMove<Config>::MoveFromRowCol(u32 row, u32 col)
 {
-    Move result = {};
+    BasicMove result = {};
 
-    result.row = move_index / GRID_DIM_COL;
-    result.col = move_index - result.row * GRID_DIM_COL;
+    if (row < Config::rows && col < Config::cols)
+    {
+        result.index = (u8)(row * Config::cols + col);
+    }
+    else
+    {
+        result.Invalidate();
+    }
 
     return result;
 }
 
-bool operator==(const Move &a, const Move &b)
+template <typename Config>
+bool operator==(const BasicMove<Config> &a, const BasicMove<Config> &b)
 {
-    return (a.row == b.row && a.col == b.col);
+    return a.index == b.index;
 }
 
-bool operator!=(const Move &a, const Move &b)
+template <typename Config>
+bool operator!=(const BasicMove<Config> &a, const BasicMove<Config> &b)
 {
-    return (a.row != b.row || a.col != b.col);
+    return a.index != b.index;
 }
 
-bool operator<(const Move &a, const Move &b)
+template <typename Config>
+bool operator<(const BasicMove<Config> &a, const BasicMove<Config> &b)
 {
     return a.GetIndex() < b.GetIndex();
 }
 
-u32 Move::GetIndex(void) const
+template <typename Config>
+u32 BasicMove<Config>::GetIndex(void) const
+{
+    return index;
+}
+
+template <typename Config>
+u32 BasicMove<Config>::GetRow(void) const
 {
-    u32 move_index = row * GRID_DIM_COL + col;
+    assert(IsValid());
+    return index / Config::cols;
+}
 
-    return move_index;
+template <typename Config>
+u32 BasicMove<Config>::GetCol(void) const
+{
+    assert(IsValid());
+    return index % Config::cols;
 }
 
-bool Move::IsValid(void) const
+template <typename Config>
+bool BasicMove<Config>::IsValid(void) const
 {
-    return (row < GRID_DIM_ROW && col < GRID_DIM_COL);
+    return index < Config::number_of_grids;
 }
 
-void Move::Invalidate(void)
+template <typename Config>
+void BasicMove<Config>::Invalidate(void)
 {
-    row = GRID_DIM_ROW;
-    col = GRID_DIM_COL;
+    index = (u8)Config::number_of_grids;
 }
 
+using Move = BasicMove<ActiveGameConfig>;
+
 enum class GameOutcome
 {
     WIN,
@@ -263,121 +528,280 @@ enum class GameOutcome
     NONE
 };
 
+// NOTE(david): one bit per grid, the bit index is the move index
+typedef u64 BoardMask;
+
+// NOTE(david): random key for every grid and player, the hash of a position is the xor of the keys of its taken grids
+template <typename Config>
+struct ZobristKeys
+{
+    // NOTE(david): indexed by the move index and the Player
+    u64 grids[Config::number_of_grids][2];
+};
+
+template <typename Config>
+static constexpr ZobristKeys<Config> GenerateZobristKeys(void)
+{
+    ZobristKeys<Config> result = {};
+
+    // NOTE(david): fixed seed, so that the hash of a position is the same on every run
+    u64 state = 0x5a6f6272697374ull;
+    for (u32 grid_index = 0; grid_index < Config::number_of_grids; ++grid_index)
+    {
+        result.grids[grid_index][(u32)Player::CROSS] = SplitMix64(&state);
+        result.grids[grid_index][(u32)Player::CIRCLE] = SplitMix64(&state);
+    }
+
+    return result;
+}
+
+template <typename Config>
+static constexpr ZobristKeys<Config> g_zobrist_keys = GenerateZobristKeys<Config>();
+
 // NOTE(david): this doesn't apply to all games, but for board games where each grid is taken by 1 player is fine for now
-struct MoveToPlayerMap
+template <typename Config>
+struct BasicMoveToPlayerMap
 {
-    Player map[GRID_DIM_COL * GRID_DIM_ROW];
+    static_assert(Config::number_of_grids <= 8 * sizeof(BoardMask), "the board doesn't fit into a BoardMask");
+
+    // NOTE(david): indexed by the Player
+    BoardMask player_masks[2];
     u32 available_grids;
+    // NOTE(david): updated on every change, the player to move isn't part of it as it follows from the number of taken grids
+    u64 zobrist_hash;
 
     Player GetPlayer(u32 row, u32 col) const;
-    Player GetPlayer(Move move) const;
-    void   AddPlayer(Move move, Player player);
+    Player GetPlayer(BasicMove<Config> move) const;
+    BoardMask GetPlayerMask(Player player) const;
+    void   AddPlayer(BasicMove<Config> move, Player player);
+    void   RemovePlayer(BasicMove<Config> move);
     void   Clear(void);
     bool   IsFull(void);
 };
 
-bool MoveToPlayerMap::IsFull(void)
+template <typename Config>
+bool BasicMoveToPlayerMap<Config>::IsFull(void)
 {
     return available_grids == 0;
 }
 
-Player MoveToPlayerMap::GetPlayer(u32 row, u32 col) const
+template <typename Config>
+Player BasicMoveToPlayerMap<Config>::GetPlayer(u32 row, u32 col) const
 {
-    Move move = { row, col };
-    u32 map_index = move.GetIndex();
-    assert(map_index < ArrayCount(MoveToPlayerMap::map));
-    return map[map_index];
+    BasicMove<Config> move = BasicMove<Config>::MoveFromRowCol(row, col);
+    return GetPlayer(move);
 }
 
-Player MoveToPlayerMap::GetPlayer(Move move) const
+template <typename Config>
+Player BasicMoveToPlayerMap<Config>::GetPlayer(BasicMove<Config> move) const
 {
     u32 map_index = move.GetIndex();
-    assert(map_index < ArrayCount(MoveToPlayerMap::map));
-    return map[map_index];
+    assert(map_index < Config::number_of_grids);
+    BoardMask move_mask = (BoardMask)1 << map_index;
+    if (player_masks[(u32)Player::CROSS] & move_mask)
+    {
+        return Player::CROSS;
+    }
+    if (player_masks[(u32)Player::CIRCLE] & move_mask)
+    {
+        return Player::CIRCLE;
+    }
+    return Player::NONE;
+}
+
+template <typename Config>
+BoardMask BasicMoveToPlayerMap<Config>::GetPlayerMask(Player player) const
+{
+    assert(player == Player::CROSS || player == Player::CIRCLE);
+    return player_masks[(u32)player];
 }
 
-void MoveToPlayerMap::AddPlayer(Move move, Player player)
+template <typename Config>
+void BasicMoveToPlayerMap<Config>::AddPlayer(BasicMove<Config> move, Player player)
 {
     u32 map_index = move.GetIndex();
     assert(available_grids > 0);
     --available_grids;
-    assert(map_index < ArrayCount(MoveToPlayerMap::map));
-    map[map_index] = player;
+    assert(map_index < Config::number_of_grids);
+    assert(player == Player::CROSS || player == Player::CIRCLE);
+    BoardMask move_mask = (BoardMask)1 << map_index;
+    assert(((player_masks[(u32)Player::CROSS] | player_masks[(u32)Player::CIRCLE]) & move_mask) == 0 && "grid is already taken");
+    player_masks[(u32)player] |= move_mask;
+    zobrist_hash ^= g_zobrist_keys<Config>.grids[map_index][(u32)player];
+}
+
+template <typename Config>
+void BasicMoveToPlayerMap<Config>::RemovePlayer(BasicMove<Config> move)
+{
+    Player player = GetPlayer(move);
+    assert(player != Player::NONE && "grid isn't taken");
+    u32 map_index = move.GetIndex();
+    player_masks[(u32)player] &= ~((BoardMask)1 << map_index);
+    ++available_grids;
+    assert(available_grids <= Config::number_of_grids);
+    zobrist_hash ^= g_zobrist_keys<Config>.grids[map_index][(u32)player];
+}
+
+template <typename Config>
+void BasicMoveToPlayerMap<Config>::Clear(void)
+{
+    available_grids = Config::number_of_grids;
+    player_masks[(u32)Player::CROSS] = 0;
+    player_masks[(u32)Player::CIRCLE] = 0;
+    zobrist_hash = 0;
 }
 
-void MoveToPlayerMap::Clear(void)
+// NOTE(david): the minimum instruction set is x86-64 with POPCNT, which is checked at startup, every processor since Nehalem and Barcelona has it
+// TZCNT needs BMI1, but it's encoded as REP BSF, which the processors without BMI1 run as BSF, that gives the same result for any input but 0, and it's never called with 0
+static bool IsPopcntSupported(void)
 {
-    available_grids = GRID_DIM_ROW * GRID_DIM_COL;
-    for (u32 row = 0; row < GRID_DIM_ROW; ++row)
+    i32 cpu_info[4];
+    __cpuidex(cpu_info, 1, 0);
+    return (cpu_info[2] & (1 << 23)) != 0;
+}
+
+// NOTE(david): PDEP selects the nth legal move in a single instruction, but it's only worth it if the processor has BMI2 and doesn't run PDEP in microcode, which AMD did before Zen 3 (family 19h)
+static bool IsFastPdepSupported(void)
+{
+    i32 cpu_info[4];
+    __cpuidex(cpu_info, 0, 0);
+    if (cpu_info[0] < 7)
     {
-        for (u32 col = 0; col < GRID_DIM_COL; ++col)
-        {
-            Move move = { row, col };
-            u32 map_index = move.GetIndex();
-            map[map_index] = Player::NONE;
-        }
+        return false;
+    }
+    // NOTE(david): the vendor string is in EBX, EDX, ECX in this order
+    bool is_amd = cpu_info[1] == 0x68747541 && cpu_info[3] == 0x69746e65 && cpu_info[2] == 0x444d4163;
+    __cpuidex(cpu_info, 1, 0);
+    u32 family = ((u32)cpu_info[0] >> 8) & 0xf;
+    if (family == 0xf)
+    {
+        family += ((u32)cpu_info[0] >> 20) & 0xff;
+    }
+    if (is_amd && family < 0x19)
+    {
+        return false;
     }
+    __cpuidex(cpu_info, 7, 0);
+    return (cpu_info[1] & (1 << 8)) != 0;
 }
 
-struct MoveSet
-{
-    // TODO(david): may want a dynamic size structure as this can get big or may want to store the action space differently and with more domain knowledge
-    Move  moves[GRID_DIM_ROW * GRID_DIM_COL];
-    u32   moves_left;
+static const bool g_is_fast_pdep_supported = IsFastPdepSupported();
 
-    void  DeleteMove(Move move);
-    void  AddMove(Move move);
+// NOTE(david): one bit per legal move, the bit index is the move index
+template <typename Config>
+struct BasicMoveSet
+{
+    static constexpr u32 max_number_of_moves = Config::number_of_grids;
+    static_assert(max_number_of_moves <= 8 * sizeof(BoardMask), "the moves don't fit into a BoardMask");
+
+    BoardMask legal_moves_mask;
+
+    u32   NumberOfMoves(void) const;
+    bool  IsLegal(BasicMove<Config> move) const;
+    // NOTE(david): the legal moves are ordered by their move indices
+    BasicMove<Config> GetMoveAtIndex(u32 nth_move) const;
+    // NOTE(david): returns an invalid move if there is no legal move with at least this move index
+    BasicMove<Config> GetFirstMoveFrom(u32 move_index) const;
+    void  DeleteMove(BasicMove<Config> move);
+    void  AddMove(BasicMove<Config> move);
     void  Clear(void);
 };
 
-void MoveSet::Clear(void)
+template <typename Config>
+u32 BasicMoveSet<Config>::NumberOfMoves(void) const
+{
+    return (u32)__popcnt64(legal_moves_mask);
+}
+
+template <typename Config>
+bool BasicMoveSet<Config>::IsLegal(BasicMove<Config> move) const
+{
+    assert(move.IsValid());
+    return (legal_moves_mask & ((BoardMask)1 << move.GetIndex())) != 0;
+}
+
+template <typename Config>
+BasicMove<Config> BasicMoveSet<Config>::GetMoveAtIndex(u32 nth_move) const
 {
-    for (u32 move_index = 0; move_index < ArrayCount(moves); ++move_index)
+    assert(nth_move < NumberOfMoves());
+    BoardMask nth_move_mask;
+    if (g_is_fast_pdep_supported)
+    {
+        // NOTE(david): deposits the bit to the position of the nth set bit of the legal moves
+        nth_move_mask = _pdep_u64((BoardMask)1 << nth_move, legal_moves_mask);
+    }
+    else
     {
-        moves[move_index].Invalidate();
+        BoardMask remaining_moves_mask = legal_moves_mask;
+        for (u32 move_index = 0; move_index < nth_move; ++move_index)
+        {
+            remaining_moves_mask &= remaining_moves_mask - 1;
+        }
+        nth_move_mask = remaining_moves_mask;
     }
+
+    assert(nth_move_mask != 0);
+    return BasicMove<Config>::MoveFromIndex((u32)_tzcnt_u64(nth_move_mask));
 }
 
-void MoveSet::DeleteMove(Move move)
+template <typename Config>
+BasicMove<Config> BasicMoveSet<Config>::GetFirstMoveFrom(u32 move_index) const
 {
-    assert(moves_left > 0);
-    --moves_left;
-    assert(move.IsValid());
-    u32 move_index = move.GetIndex();
-    assert(moves[move_index].IsValid());
-    moves[move_index].Invalidate();
-    // for (u32 move_index = 0; move_index < moves_left; ++move_index)
-    // {
-    //     if (moves[move_index] == move)
-    //     {
-    //         assert(moves[move_index].IsValid());
-    //         moves[move_index] = moves[moves_left - 1];
-    //         moves[moves_left - 1].Invalidate();
-    //         --moves_left;
-    //         return ;
-    //     }
-    // }
-    // assert(false && "tried to delete a move that didn't exist");
-}
-
-void MoveSet::AddMove(Move move)
+    BasicMove<Config> result;
+    BoardMask remaining_moves_mask = move_index < max_number_of_moves ? legal_moves_mask & ~(((BoardMask)1 << move_index) - 1) : 0;
+    if (remaining_moves_mask == 0)
+    {
+        result.Invalidate();
+    }
+    else
+    {
+        result = BasicMove<Config>::MoveFromIndex((u32)_tzcnt_u64(remaining_moves_mask));
+    }
+
+    return result;
+}
+
+template <typename Config>
+void BasicMoveSet<Config>::Clear(void)
 {
-    assert(move.IsValid());
-    u32 move_index = move.GetIndex();
-    assert(move_index < ArrayCount(MoveSet::moves));
-    assert(moves[move_index].IsValid() == false);
-    moves[move_index] = move;
-    ++moves_left;
+    legal_moves_mask = 0;
+}
+
+template <typename Config>
+void BasicMoveSet<Config>::DeleteMove(BasicMove<Config> move)
+{
+    assert(IsLegal(move));
+    legal_moves_mask &= ~((BoardMask)1 << move.GetIndex());
+}
+
+template <typename Config>
+void BasicMoveSet<Config>::AddMove(BasicMove<Config> move)
+{
+    assert(IsLegal(move) == false);
+    legal_moves_mask |= (BoardMask)1 << move.GetIndex();
 }
 
-struct GameState
+template <typename Config>
+struct BasicGameState
 {
-    MoveToPlayerMap  move_to_player_map;
-    Player           player_to_move;
-    GameOutcome      outcome_for_previous_player;
-    MoveSet          legal_moveset;
+    BasicMoveToPlayerMap<Config>  move_to_player_map;
+    Player                        player_to_move;
+    GameOutcome                   outcome_for_previous_player;
+    BasicMoveSet<Config>          legal_moveset;
+
+    // NOTE(david): plays the move for the player to move and determines the outcome after it
+    void MakeMove(BasicMove<Config> move);
+    // NOTE(david): takes back the move, there is nothing else to restore, as a move could only be made while the outcome was NONE
+    // ASSUMPTION(david): move is the last move that was made with MakeMove
+    void UnmakeMove(BasicMove<Config> move);
+    // NOTE(david): hash of the position after the player to move plays the move, without making it
+    u64  ZobristHashAfterMove(BasicMove<Config> move) const;
 };
 
+using MoveToPlayerMap = BasicMoveToPlayerMap<ActiveGameConfig>;
+using MoveSet = BasicMoveSet<ActiveGameConfig>;
+using GameState = BasicGameState<ActiveGameConfig>;
+
 static string PlayerToWord(Player player)
 {
     switch (player)
@@ -416,21 +840,22 @@ static string GameOutcomeToWord(GameOutcome game_outcome)
     }
 }
 
-void PrintGameState(const GameState &game_state, ostream &os)
+template <typename Config>
+void PrintGameState(const BasicGameState<Config> &game_state, ostream &os)
 {
-    for (u32 row = 0; row < GRID_DIM_ROW; ++row)
+    for (u32 row = 0; row < Config::rows; ++row)
     {
         if (row == 0)
         {
             LOGN(os, "  ");
-            for (u32 col = 0; col < GRID_DIM_COL; ++col)
+            for (u32 col = 0; col < Config::cols; ++col)
             {
                 LOGN(os, to_string(col) + " ");
             }
             LOG(os, "");
         }
         LOGN(os, to_string(row) + " ");
-        for (u32 col = 0; col < GRID_DIM_COL; ++col)
+        for (u32 col = 0; col < Config::cols; ++col)
         {
             Player player_that_made_move = game_state.move_to_player_map.GetPlayer(row, col);
             if (player_that_made_move != Player::NONE)
@@ -447,97 +872,247 @@ void PrintGameState(const GameState &game_state, ostream &os)
     }
 }
 
-// ASSUMPTION(david): prior GameState before the move was NONE, we want to see if that changed
-GameOutcome DetermineGameOutcomeAfterMove(GameState &game_state, Player player_to_move_and_win, Move last_move)
+// NOTE(david): bit i stands for g_winning_lines.lines[i], the bits are split into as many u64 words as the lines of the variant need
+template <u32 NumberOfLines>
+struct BasicLineBits
 {
-    assert(game_state.move_to_player_map.GetPlayer(last_move) == player_to_move_and_win);
-    // check all 8 directions
-    u32 north_counter = 0;
-    for (Move move = { last_move.row - 1, last_move.col }; ; --move.row, ++north_counter)
+    static constexpr u32 number_of_words = (NumberOfLines + 63) / 64;
+
+    u64 words[number_of_words];
+};
+
+template <u32 NumberOfLines>
+constexpr void SetLineBit(BasicLineBits<NumberOfLines> &line_bits, u32 line_index)
+{
+    assert(line_index < NumberOfLines);
+    line_bits.words[line_index / 64] |= (u64)1 << (line_index % 64);
+}
+
+template <u32 NumberOfLines>
+BasicLineBits<NumberOfLines> &operator|=(BasicLineBits<NumberOfLines> &a, const BasicLineBits<NumberOfLines> &b)
+{
+    for (u32 word_index = 0; word_index < BasicLineBits<NumberOfLines>::number_of_words; ++word_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
-        {
-            break ;
-        }
+        a.words[word_index] |= b.words[word_index];
     }
-    u32 south_counter = 0;
-    for (Move move = { last_move.row + 1, last_move.col }; ; ++move.row, ++south_counter)
+
+    return a;
+}
+
+template <u32 NumberOfLines>
+BasicLineBits<NumberOfLines> operator|(BasicLineBits<NumberOfLines> a, const BasicLineBits<NumberOfLines> &b)
+{
+    return a |= b;
+}
+
+template <u32 NumberOfLines>
+bool operator==(const BasicLineBits<NumberOfLines> &a, const BasicLineBits<NumberOfLines> &b)
+{
+    for (u32 word_index = 0; word_index < BasicLineBits<NumberOfLines>::number_of_words; ++word_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
+        if (a.words[word_index] != b.words[word_index])
         {
-            break ;
+            return false;
         }
     }
 
-    if (north_counter + south_counter + 1 == ConnectToWinCount)
-    {
-        return GameOutcome::WIN;
-    }
+    return true;
+}
+
+// NOTE(david): every connect_to_win_count long horizontal, vertical and diagonal line of grids on the board, generated at compile time
+template <typename Config>
+struct WinningLines
+{
+    static constexpr u32 max_number_of_lines =
+        Config::rows * (Config::cols - Config::connect_to_win_count + 1) +
+        Config::cols * (Config::rows - Config::connect_to_win_count + 1) +
+        2 * (Config::rows - Config::connect_to_win_count + 1) * (Config::cols - Config::connect_to_win_count + 1);
+    // NOTE(david): a grid is on at most connect_to_win_count lines in each of the 4 directions
+    static constexpr u32 max_number_of_lines_per_grid = 4 * Config::connect_to_win_count;
+
+    BoardMask lines[max_number_of_lines];
+    u32 number_of_lines;
+    // NOTE(david): the lines that go through the grid, indexed by the move index
+    BoardMask lines_through_grid[Config::number_of_grids][max_number_of_lines_per_grid];
+    u32 number_of_lines_through_grid[Config::number_of_grids];
+    // NOTE(david): bit i is set if lines[i] goes through the grid, indexed by the move index
+    BasicLineBits<max_number_of_lines> line_bits_through_grid[Config::number_of_grids];
+};
 
-    u32 west_counter = 0;
-    for (Move move = { last_move.row, last_move.col - 1 }; ; --move.col, ++west_counter)
+template <typename Config>
+using LineBits = BasicLineBits<WinningLines<Config>::max_number_of_lines>;
+
+template <typename Config>
+static constexpr WinningLines<Config> GenerateWinningLines(void)
+{
+    WinningLines<Config> result = {};
+
+    // NOTE(david): directions as (row, col) steps: east, south, south east, south west
+    i32 direction_rows[4] = { 0, 1, 1, 1 };
+    i32 direction_cols[4] = { 1, 0, 1, -1 };
+    for (u32 direction_index = 0; direction_index < 4; ++direction_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
+        for (i32 start_row = 0; start_row < (i32)Config::rows; ++start_row)
         {
-            break ;
+            for (i32 start_col = 0; start_col < (i32)Config::cols; ++start_col)
+            {
+                i32 end_row = start_row + direction_rows[direction_index] * (i32)(Config::connect_to_win_count - 1);
+                i32 end_col = start_col + direction_cols[direction_index] * (i32)(Config::connect_to_win_count - 1);
+                if (end_row < 0 || end_row >= (i32)Config::rows || end_col < 0 || end_col >= (i32)Config::cols)
+                {
+                    continue ;
+                }
+                BoardMask line = 0;
+                for (i32 grid_index = 0; grid_index < (i32)Config::connect_to_win_count; ++grid_index)
+                {
+                    // NOTE(david): same as BasicMove::GetIndex
+                    u32 move_index = (u32)(start_row + direction_rows[direction_index] * grid_index) * Config::cols + (u32)(start_col + direction_cols[direction_index] * grid_index);
+                    line |= (BoardMask)1 << move_index;
+                }
+                u32 line_index = result.number_of_lines++;
+                result.lines[line_index] = line;
+                for (i32 grid_index = 0; grid_index < (i32)Config::connect_to_win_count; ++grid_index)
+                {
+                    u32 move_index = (u32)(start_row + direction_rows[direction_index] * grid_index) * Config::cols + (u32)(start_col + direction_cols[direction_index] * grid_index);
+                    result.lines_through_grid[move_index][result.number_of_lines_through_grid[move_index]++] = line;
+                    SetLineBit(result.line_bits_through_grid[move_index], line_index);
+                }
+            }
         }
     }
-    u32 east_counter = 0;
-    for (Move move = { last_move.row, last_move.col + 1 }; ; ++move.col, ++east_counter)
+
+    return result;
+}
+
+template <typename Config>
+static constexpr WinningLines<Config> g_winning_lines = GenerateWinningLines<Config>();
+
+static_assert(g_winning_lines<ActiveGameConfig>.number_of_lines == WinningLines<ActiveGameConfig>::max_number_of_lines, "every winning line has to be generated");
+// NOTE(david): the other variants that are known to work
+static_assert(g_winning_lines<GameConfig<3, 3, 3>>.number_of_lines == 8, "3x3 tic-tac-toe has 8 winning lines");
+static_assert(g_winning_lines<GameConfig<7, 7, 5>>.number_of_lines == WinningLines<GameConfig<7, 7, 5>>::max_number_of_lines, "every winning line has to be generated");
+// NOTE(david): more lines than the bits of a word
+static_assert(g_winning_lines<GameConfig<8, 8, 4>>.number_of_lines == WinningLines<GameConfig<8, 8, 4>>::max_number_of_lines, "every winning line has to be generated");
+static_assert(LineBits<GameConfig<8, 8, 4>>::number_of_words == 3, "the 130 lines of 8x8 connect 4 take 3 words");
+
+// ASSUMPTION(david): prior GameState before the move was NONE, we want to see if that changed
+template <typename Config>
+GameOutcome DetermineGameOutcomeAfterMove(BasicGameState<Config> &game_state, Player player_to_move_and_win, BasicMove<Config> last_move)
+{
+    assert(game_state.move_to_player_map.GetPlayer(last_move) == player_to_move_and_win);
+    // NOTE(david): as there was no winning line before the move, only the lines through the last move can be completed
+    BoardMask player_mask = game_state.move_to_player_map.GetPlayerMask(player_to_move_and_win);
+    u32 last_move_index = last_move.GetIndex();
+    const BoardMask *lines_through_last_move = g_winning_lines<Config>.lines_through_grid[last_move_index];
+    for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines_through_grid[last_move_index]; ++line_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
+        BoardMask line = lines_through_last_move[line_index];
+        if ((player_mask & line) == line)
         {
-            break ;
+            return GameOutcome::WIN;
         }
     }
 
-    if (west_counter + east_counter + 1 == ConnectToWinCount)
+    if (game_state.move_to_player_map.IsFull())
     {
-        return GameOutcome::WIN;
+        return GameOutcome::DRAW;
     }
 
-    u32 north_west_counter = 0;
-    for (Move move = { last_move.row - 1, last_move.col - 1 }; ; --move.row, --move.col, ++north_west_counter)
-    {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
-        {
-            break ;
-        }
-    }
-    u32 south_east_counter = 0;
-    for (Move move = { last_move.row + 1, last_move.col + 1 }; ; ++move.row, ++move.col, ++south_east_counter)
+    return GameOutcome::NONE;
+}
+
+// NOTE(david): a line can still be completed by a player as long as the opponent has no grid on it, the position is dead if that's not the case for any line for either player
+template <typename Config>
+bool IsDeadPosition(BoardMask cross_mask, BoardMask circle_mask)
+{
+    for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines; ++line_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
+        BoardMask line = g_winning_lines<Config>.lines[line_index];
+        if ((line & circle_mask) == 0 || (line & cross_mask) == 0)
         {
-            break ;
+            return false;
         }
     }
 
-    if (north_west_counter + south_east_counter + 1 == ConnectToWinCount)
+    return true;
+}
+
+// NOTE(david): bit i is set if the player has a grid on g_winning_lines.lines[i], a move only adds the bits of the lines through it, so the search keeps one of these per player and updates it with every move
+template <typename Config>
+LineBits<Config> GetLinesTakenMask(BoardMask player_mask)
+{
+    LineBits<Config> result = {};
+    for (BoardMask remaining_grids_mask = player_mask; remaining_grids_mask != 0; remaining_grids_mask &= remaining_grids_mask - 1)
     {
-        return GameOutcome::WIN;
+        result |= g_winning_lines<Config>.line_bits_through_grid[_tzcnt_u64(remaining_grids_mask)];
     }
 
-    u32 north_east_counter = 0;
-    for (Move move = { last_move.row - 1, last_move.col + 1 }; ; --move.row, ++move.col, ++north_east_counter)
+    return result;
+}
+
+// NOTE(david): same as IsDeadPosition, every line is taken by both players
+template <typename Config>
+inline bool AreAllLinesTaken(const LineBits<Config> &cross_lines_taken_mask, const LineBits<Config> &circle_lines_taken_mask)
+{
+    constexpr u32 number_of_lines = g_winning_lines<Config>.number_of_lines;
+    for (u32 word_index = 0; word_index < LineBits<Config>::number_of_words; ++word_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
+        // NOTE(david): only the last word is partially used
+        u32 number_of_lines_in_word = min(number_of_lines - 64 * word_index, (u32)64);
+        u64 all_lines_mask = number_of_lines_in_word == 64 ? ~(u64)0 : ((u64)1 << number_of_lines_in_word) - 1;
+        if ((cross_lines_taken_mask.words[word_index] & circle_lines_taken_mask.words[word_index]) != all_lines_mask)
         {
-            break ;
+            return false;
         }
     }
-    u32 south_west_counter = 0;
-    for (Move move = { last_move.row + 1, last_move.col - 1 }; ; ++move.row, --move.col, ++south_west_counter)
+
+    return true;
+}
+
+template <typename Config>
+void BasicGameState<Config>::MakeMove(BasicMove<Config> move)
+{
+    assert(outcome_for_previous_player == GameOutcome::NONE && "the game is already over");
+    legal_moveset.DeleteMove(move);
+    move_to_player_map.AddPlayer(move, player_to_move);
+    outcome_for_previous_player = DetermineGameOutcomeAfterMove(*this, player_to_move, move);
+    player_to_move = player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
+}
+
+template <typename Config>
+void BasicGameState<Config>::UnmakeMove(BasicMove<Config> move)
+{
+    player_to_move = player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
+    assert(move_to_player_map.GetPlayer(move) == player_to_move && "move wasn't made by the previous player");
+    move_to_player_map.RemovePlayer(move);
+    legal_moveset.AddMove(move);
+    outcome_for_previous_player = GameOutcome::NONE;
+}
+
+template <typename Config>
+u64 BasicGameState<Config>::ZobristHashAfterMove(BasicMove<Config> move) const
+{
+    assert(legal_moveset.IsLegal(move));
+    return move_to_player_map.zobrist_hash ^ g_zobrist_keys<Config>.grids[move.GetIndex()][(u32)player_to_move];
+}
+
+template <typename Config>
+GameOutcome DetermineGameOutcome(BasicGameState<Config> &game_state, Player player_to_win)
+{
+    Player player_to_lose = player_to_win == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
+    BoardMask player_to_win_mask = game_state.move_to_player_map.GetPlayerMask(player_to_win);
+    BoardMask player_to_lose_mask = game_state.move_to_player_map.GetPlayerMask(player_to_lose);
+    for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines; ++line_index)
     {
-        if (move.IsValid() == false || game_state.move_to_player_map.GetPlayer(move) != player_to_move_and_win)
+        BoardMask line = g_winning_lines<Config>.lines[line_index];
+        if ((player_to_win_mask & line) == line)
         {
-            break ;
+            return GameOutcome::WIN;
+        }
+        if ((player_to_lose_mask & line) == line)
+        {
+            return GameOutcome::LOSS;
         }
-    }
-
-    if (north_east_counter + south_west_counter + 1 == ConnectToWinCount)
-    {
-        return GameOutcome::WIN;
     }
 
     if (game_state.move_to_player_map.IsFull())
@@ -548,154 +1123,376 @@ GameOutcome DetermineGameOutcomeAfterMove(GameState &game_state, Player player_t
     return GameOutcome::NONE;
 }
 
-GameOutcome DetermineGameOutcome(GameState &game_state, Player player_to_win)
+// NOTE(david): AVX2 needs the processor to support it and the OS to save the upper halves of the ymm registers on a context switch
+static bool IsAvx2Supported(void)
 {
-    // check rows/cols
-    for (u32 row = 0; row < GRID_DIM_ROW; ++row)
+    i32 cpu_info[4];
+    __cpuidex(cpu_info, 0, 0);
+    if (cpu_info[0] < 7)
     {
-        u32 cur_circles = 0;
-        u32 cur_crosses = 0;
-        for (u32 col = 0; col < GRID_DIM_COL; ++col)
-        {
-            Player cur_player = game_state.move_to_player_map.GetPlayer(row, col);
-            if (cur_player == Player::CIRCLE)
-            {
-                if (++cur_circles == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CIRCLE ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_crosses = 0;
+        return false;
+    }
+    __cpuidex(cpu_info, 1, 0);
+    bool is_osxsave_supported = (cpu_info[2] & (1 << 27)) != 0;
+    bool is_avx_supported = (cpu_info[2] & (1 << 28)) != 0;
+    if (is_osxsave_supported == false || is_avx_supported == false)
+    {
+        return false;
+    }
+    // NOTE(david): both the xmm and the ymm state has to be enabled in XCR0
+    if ((_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(cpu_info, 7, 0);
+    return (cpu_info[1] & (1 << 5)) != 0;
+}
+
+static const bool g_is_avx2_supported = IsAvx2Supported();
+
+// NOTE(david): most boards this is called with are expected to be batched playouts, so 64 boards at most, one bit for each in the result
+constexpr u32 max_number_of_boards_in_batch = 64;
+
+template <typename Config>
+static u64 DidLastMoveWinScalar(const BoardMask *player_masks, u32 number_of_boards)
+{
+    u64 result = 0;
+    for (u32 board_index = 0; board_index < number_of_boards; ++board_index)
+    {
+        BoardMask player_mask = player_masks[board_index];
+        for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines; ++line_index)
+        {
+            BoardMask line = g_winning_lines<Config>.lines[line_index];
+            if ((player_mask & line) == line)
+            {
+                result |= (u64)1 << board_index;
+                break ;
             }
-            else if (cur_player == Player::CROSS)
+        }
+    }
+
+    return result;
+}
+
+template <typename Config>
+static u64 DidLastMoveWinAvx2(const BoardMask *player_masks, u32 number_of_boards)
+{
+    u64 result = 0;
+    if (Config::number_of_grids <= 32)
+    {
+        // NOTE(david): the board fits in 32 bits, so 8 boards are packed in a register, two registers are checked against each broadcasted line
+        for (u32 board_index = 0; board_index < number_of_boards; board_index += 16)
+        {
+            alignas(32) u32 packed_player_masks[16] = {};
+            u32 number_of_boards_in_pack = min(number_of_boards - board_index, 16u);
+            for (u32 lane_index = 0; lane_index < number_of_boards_in_pack; ++lane_index)
             {
-                if (++cur_crosses == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CROSS ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_circles = 0;
+                packed_player_masks[lane_index] = (u32)player_masks[board_index + lane_index];
             }
-            else
+            __m256i player_masks_low = _mm256_load_si256((const __m256i *)&packed_player_masks[0]);
+            __m256i player_masks_high = _mm256_load_si256((const __m256i *)&packed_player_masks[8]);
+            __m256i did_win_low = _mm256_setzero_si256();
+            __m256i did_win_high = _mm256_setzero_si256();
+            for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines; ++line_index)
             {
-                cur_crosses = 0;
-                cur_circles = 0;
+                __m256i line = _mm256_set1_epi32((i32)g_winning_lines<Config>.lines[line_index]);
+                did_win_low = _mm256_or_si256(did_win_low, _mm256_cmpeq_epi32(_mm256_and_si256(player_masks_low, line), line));
+                did_win_high = _mm256_or_si256(did_win_high, _mm256_cmpeq_epi32(_mm256_and_si256(player_masks_high, line), line));
             }
+            // NOTE(david): the empty padding lanes can't contain a line, so they never win
+            u64 did_win_lanes =
+                (u64)(u32)_mm256_movemask_ps(_mm256_castsi256_ps(did_win_low)) |
+                ((u64)(u32)_mm256_movemask_ps(_mm256_castsi256_ps(did_win_high)) << 8);
+            result |= did_win_lanes << board_index;
         }
     }
-    for (u32 col = 0; col < GRID_DIM_COL; ++col)
+    else
     {
-        u32 cur_circles = 0;
-        u32 cur_crosses = 0;
-        for (u32 row = 0; row < GRID_DIM_ROW; ++row)
+        for (u32 board_index = 0; board_index < number_of_boards; board_index += 4)
         {
-            Player cur_player = game_state.move_to_player_map.GetPlayer(row, col);
-            if (cur_player == Player::CIRCLE)
+            alignas(32) BoardMask packed_player_masks[4] = {};
+            u32 number_of_boards_in_pack = min(number_of_boards - board_index, 4u);
+            for (u32 lane_index = 0; lane_index < number_of_boards_in_pack; ++lane_index)
             {
-                if (++cur_circles == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CIRCLE ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_crosses = 0;
-            }
-            else if (cur_player == Player::CROSS)
-            {
-                if (++cur_crosses == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CROSS ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_circles = 0;
+                packed_player_masks[lane_index] = player_masks[board_index + lane_index];
             }
-            else
+            __m256i packed_masks = _mm256_load_si256((const __m256i *)packed_player_masks);
+            __m256i did_win = _mm256_setzero_si256();
+            for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines; ++line_index)
             {
-                cur_crosses = 0;
-                cur_circles = 0;
+                __m256i line = _mm256_set1_epi64x((i64)g_winning_lines<Config>.lines[line_index]);
+                did_win = _mm256_or_si256(did_win, _mm256_cmpeq_epi64(_mm256_and_si256(packed_masks, line), line));
             }
+            result |= (u64)(u32)_mm256_movemask_pd(_mm256_castsi256_pd(did_win)) << board_index;
         }
     }
 
-    // check diagonals
-    for (u32 start_col = 0, start_row_offset = 0; start_col < GRID_DIM_COL || start_row_offset < GRID_DIM_ROW; ++start_col)
+    return result;
+}
+
+// NOTE(david): batched form of DetermineGameOutcomeAfterMove, player_masks are the masks of the players that made the last move on each board
+// ASSUMPTION(david): same as for DetermineGameOutcomeAfterMove, none of the boards had a winning line before the last move, the caller tells a draw from the board being full
+// returns the boards where the last move won as a bitmask, bit n is set if the nth board was won
+template <typename Config>
+u64 DidLastMoveWin(const BoardMask *player_masks, u32 number_of_boards)
+{
+    assert(number_of_boards <= max_number_of_boards_in_batch);
+    if (g_is_avx2_supported)
+    {
+        return DidLastMoveWinAvx2<Config>(player_masks, number_of_boards);
+    }
+
+    return DidLastMoveWinScalar<Config>(player_masks, number_of_boards);
+}
+
+// NOTE(david): the empty grids where the player would complete a winning line, a line is one move away if the only grid of it that the player doesn't have is empty
+template <typename Config>
+BoardMask GetWinningMovesMask(BoardMask player_mask, BoardMask empty_mask)
+{
+    BoardMask result = 0;
+    for (u32 line_index = 0; line_index < g_winning_lines<Config>.number_of_lines; ++line_index)
     {
-        if (start_col == GRID_DIM_COL)
+        BoardMask missing_grids = g_winning_lines<Config>.lines[line_index] & ~player_mask;
+        if ((missing_grids & (missing_grids - 1)) == 0)
         {
-            start_col = GRID_DIM_COL - 1;
-            ++start_row_offset;
+            result |= missing_grids & empty_mask;
         }
-        u32 cur_circles = 0;
-        u32 cur_crosses = 0;
-        for (i32 col = start_col, row = GRID_DIM_ROW - 1 - start_row_offset;
-             col >= 0 && row >= 0;
-             --col, --row)
+    }
+
+    return result;
+}
+
+// NOTE(david): the moves of the heavy rollout policy, the winning moves of the player to move, otherwise the grids where the opponent would win, 0 if the player to move is free to move anywhere
+// if the opponent has more than one winning move, blocking one of them doesn't save the game, but any of them is as good as the other
+template <typename Config>
+BoardMask GetForcedMovesMask(BoardMask player_to_move_mask, BoardMask opponent_mask, BoardMask empty_mask)
+{
+    BoardMask winning_moves_mask = GetWinningMovesMask<Config>(player_to_move_mask, empty_mask);
+    if (winning_moves_mask != 0)
+    {
+        return winning_moves_mask;
+    }
+
+    return GetWinningMovesMask<Config>(opponent_mask, empty_mask);
+}
+
+// NOTE(david): scores of the endgame solver are relative to the player to move and to the position, a win in n plies is endgame_win_score - n, a loss in n plies is -(endgame_win_score - n), a draw is 0
+// so the score of a win or a loss is never less than 2 in absolute value, and the entries of the table don't depend on where the position was reached from
+template <typename Config>
+constexpr i32 endgame_win_score = (i32)Config::number_of_grids + 2;
+
+struct EndgameSolverEntry
+{
+    enum class Bound : u8
+    {
+        NONE,
+        EXACT,
+        // NOTE(david): the score is at least this much
+        LOWER,
+        // NOTE(david): the score is at most this much
+        UPPER
+    };
+
+    u64 key;
+    i16 score;
+    Bound bound;
+};
+
+// NOTE(david): every thread has its own table, replaced on collision, allocated on the first solve
+// the search threads are started for every evaluation, so it's kept small, positions under the threshold don't have many successors anyway and a small table stays in the cache
+constexpr u32 endgame_solver_table_size = 1 << 12;
+static thread_local vector<EndgameSolverEntry> g_endgame_solver_table;
+
+static inline i32 Sign(i32 value)
+{
+    return (value > 0) - (value < 0);
+}
+
+// NOTE(david): the score of the position from the score of the position after the move, the win or loss is one ply further away
+static inline i32 EndgameScoreFromChildScore(i32 child_score)
+{
+    return -child_score + Sign(child_score);
+}
+
+// NOTE(david): inverse of EndgameScoreFromChildScore, used to turn the window of the position into the window of the position after the move
+static inline i32 EndgameChildScoreFromScore(i32 score)
+{
+    return -score - Sign(score);
+}
+
+// NOTE(david): negamax with alpha-beta pruning, fail-soft
+// the masks of the lines taken by the players are updated with the lines through the move, so the dead positions are found without going through every line
+template <typename Config>
+static i32 SolveEndgameHelper(BasicGameState<Config> &game_state, LineBits<Config> player_lines_taken_mask, LineBits<Config> opponent_lines_taken_mask, i32 alpha, i32 beta)
+{
+    constexpr i32 win_score = endgame_win_score<Config>;
+    switch (game_state.outcome_for_previous_player)
+    {
+        case GameOutcome::WIN: {
+            // NOTE(david): the previous player completed a line, the player to move has lost
+            return -win_score;
+        } break ;
+        case GameOutcome::DRAW: {
+            return 0;
+        } break ;
+        case GameOutcome::NONE: {
+        } break ;
+        default: UNREACHABLE_CODE;
+    }
+    if (detect_dead_positions && AreAllLinesTaken<Config>(player_lines_taken_mask, opponent_lines_taken_mask))
+    {
+        return 0;
+    }
+
+    Player opponent = game_state.player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
+    BoardMask player_mask = game_state.move_to_player_map.GetPlayerMask(game_state.player_to_move);
+    BoardMask opponent_mask = game_state.move_to_player_map.GetPlayerMask(opponent);
+    BoardMask empty_mask = game_state.legal_moveset.legal_moves_mask;
+    if (GetWinningMovesMask<Config>(player_mask, empty_mask) != 0)
+    {
+        return win_score - 1;
+    }
+    BoardMask moves_mask = empty_mask;
+    BoardMask opponent_winning_moves_mask = GetWinningMovesMask<Config>(opponent_mask, empty_mask);
+    if (opponent_winning_moves_mask != 0)
+    {
+        if ((opponent_winning_moves_mask & (opponent_winning_moves_mask - 1)) != 0)
         {
-            Player cur_player = game_state.move_to_player_map.GetPlayer(row, col);
-            if (cur_player == Player::CIRCLE)
-            {
-                if (++cur_circles == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CIRCLE ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_crosses = 0;
-            }
-            else if (cur_player == Player::CROSS)
-            {
-                if (++cur_crosses == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CROSS ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_circles = 0;
-            }
-            else
-            {
-                cur_crosses = 0;
-                cur_circles = 0;
-            }
+            // NOTE(david): only one of them can be blocked
+            return -(win_score - 2);
         }
+        moves_mask = opponent_winning_moves_mask;
+    }
 
-        cur_circles = 0;
-        cur_crosses = 0;
-        for (i32 col = start_col, row = start_row_offset;
-             col >= 0 && row < GRID_DIM_ROW;
-             --col, ++row)
+    u64 key = game_state.move_to_player_map.zobrist_hash;
+    EndgameSolverEntry *entry = &g_endgame_solver_table[key & (endgame_solver_table_size - 1)];
+    if (entry->bound != EndgameSolverEntry::Bound::NONE && entry->key == key)
+    {
+        switch (entry->bound)
         {
-            Player cur_player = game_state.move_to_player_map.GetPlayer(row, col);
-            if (cur_player == Player::CIRCLE)
-            {
-                if (++cur_circles == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CIRCLE ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_crosses = 0;
-            }
-            else if (cur_player == Player::CROSS)
-            {
-                if (++cur_crosses == ConnectToWinCount)
-                {
-                    return player_to_win == Player::CROSS ? GameOutcome::WIN : GameOutcome::LOSS;
-                }
-                cur_circles = 0;
-            }
-            else
-            {
-                cur_crosses = 0;
-                cur_circles = 0;
-            }
+            case EndgameSolverEntry::Bound::EXACT: {
+                return entry->score;
+            } break ;
+            case EndgameSolverEntry::Bound::LOWER: {
+                alpha = max(alpha, (i32)entry->score);
+            } break ;
+            case EndgameSolverEntry::Bound::UPPER: {
+                beta = min(beta, (i32)entry->score);
+            } break ;
+            default: UNREACHABLE_CODE;
+        }
+        if (alpha >= beta)
+        {
+            return entry->score;
         }
     }
 
-    if (game_state.move_to_player_map.IsFull())
+    i32 original_alpha = alpha;
+    i32 best_score = -win_score - 1;
+    for (BoardMask remaining_moves_mask = moves_mask; remaining_moves_mask != 0; remaining_moves_mask &= remaining_moves_mask - 1)
     {
-        return GameOutcome::DRAW;
+        BasicMove<Config> move = BasicMove<Config>::MoveFromIndex((u32)_tzcnt_u64(remaining_moves_mask));
+        game_state.MakeMove(move);
+        i32 child_score = SolveEndgameHelper(game_state, opponent_lines_taken_mask, player_lines_taken_mask | g_winning_lines<Config>.line_bits_through_grid[move.GetIndex()], EndgameChildScoreFromScore(beta), EndgameChildScoreFromScore(alpha));
+        game_state.UnmakeMove(move);
+
+        i32 score = EndgameScoreFromChildScore(child_score);
+        best_score = max(best_score, score);
+        alpha = max(alpha, score);
+        if (alpha >= beta)
+        {
+            break ;
+        }
     }
 
-    return GameOutcome::NONE;
+    // NOTE(david): the entry might have been overwritten by the positions below
+    entry->key = key;
+    entry->score = (i16)best_score;
+    if (best_score <= original_alpha)
+    {
+        entry->bound = EndgameSolverEntry::Bound::UPPER;
+    }
+    else if (best_score >= beta)
+    {
+        entry->bound = EndgameSolverEntry::Bound::LOWER;
+    }
+    else
+    {
+        entry->bound = EndgameSolverEntry::Bound::EXACT;
+    }
+
+    return best_score;
 }
 
-bool g_should_write_out_simulation;
-ofstream g_simresult_fs;
+// NOTE(david): solves the leaf exactly, the result is terminal with the same values as the ones of simulation_from_position_once, the plies to the end of the game are the ones of perfect play, the winner wins as fast as possible, the loser loses as slow as possible
+// for a draw the number of empty grids is used, which is an upper bound of its plies, as the position might die earlier, unless the leaf is already dead, so the search doesn't rank the draws by their depth
+template <typename Config>
+SimulationResult SolveEndgame(BasicGameState<Config> &leaf_game_state, Player player_that_needs_to_win)
+{
+    constexpr i32 win_score = endgame_win_score<Config>;
+    assert(player_that_needs_to_win == Player::CROSS && "below values are only for uncontrolled node");
+    assert(leaf_game_state.outcome_for_previous_player == GameOutcome::NONE);
+    if (g_endgame_solver_table.empty())
+    {
+        g_endgame_solver_table.resize(endgame_solver_table_size);
+    }
+
+    Player opponent = leaf_game_state.player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
+    LineBits<Config> player_lines_taken_mask = GetLinesTakenMask<Config>(leaf_game_state.move_to_player_map.GetPlayerMask(leaf_game_state.player_to_move));
+    LineBits<Config> opponent_lines_taken_mask = GetLinesTakenMask<Config>(leaf_game_state.move_to_player_map.GetPlayerMask(opponent));
+    i32 score = SolveEndgameHelper(leaf_game_state, player_lines_taken_mask, opponent_lines_taken_mask, -win_score - 1, win_score + 1);
 
-SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain_depth> &movesequence_from_position, const GameState &game_state, Node *node, const NodePool &node_pool)
+    SimulationResult simulation_result = {};
+    simulation_result.num_simulations = 1;
+    if (score == 0)
+    {
+        simulation_result.value = 0.0f;
+        simulation_result.terminal_type = TerminalType::NEUTRAL;
+        simulation_result.plies_to_terminal = detect_dead_positions && AreAllLinesTaken<Config>(player_lines_taken_mask, opponent_lines_taken_mask) ? 0 : (u16)leaf_game_state.legal_moveset.NumberOfMoves();
+    }
+    else
+    {
+        Player winner = score > 0 ? leaf_game_state.player_to_move : (leaf_game_state.player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE);
+        simulation_result.value = winner == player_that_needs_to_win ? -1.0f : 1.0f;
+        simulation_result.terminal_type = winner == player_that_needs_to_win ? TerminalType::LOSING : TerminalType::WINNING;
+        simulation_result.plies_to_terminal = (u16)(win_score - abs(score));
+    }
+
+    return simulation_result;
+}
+
+static bool ShouldSolveEndgame(const GameState &leaf_game_state)
+{
+    return leaf_game_state.outcome_for_previous_player == GameOutcome::NONE && leaf_game_state.legal_moveset.NumberOfMoves() <= endgame_solver_empty_grids_threshold;
+}
+
+thread_local bool g_should_write_out_simulation;
+thread_local ofstream g_simresult_fs;
+
+// NOTE(david): the playouts of a batch share the leaf state, so every thread plays them on its own copy of it, the moves of a playout are taken back at the end of it, so the copy only has to be made again when the leaf has changed
+static thread_local GameState g_scratch_game_state;
+static thread_local bool g_is_scratch_game_state_set;
+
+static GameState &GetScratchGameState(const GameState &game_state)
+{
+    if (g_is_scratch_game_state_set == false ||
+        g_scratch_game_state.move_to_player_map.zobrist_hash != game_state.move_to_player_map.zobrist_hash ||
+        g_scratch_game_state.player_to_move != game_state.player_to_move)
+    {
+        g_scratch_game_state = game_state;
+        g_is_scratch_game_state_set = true;
+    }
+    assert(g_scratch_game_state.legal_moveset.legal_moves_mask == game_state.legal_moveset.legal_moves_mask && "scratch state is out of sync");
+
+    return g_scratch_game_state;
+}
+
+// NOTE(david): plays a random game from the leaf state in place, the leaf state is the same after it returns
+SimulationResult simulation_from_position_once(GameState &cur_game_state, Player player_that_needs_to_win)
 {
-    GameState cur_game_state = game_state;
-    Player player_that_needs_to_win = cur_game_state.player_to_move;
+    GameOutcome leaf_outcome_for_previous_player = cur_game_state.outcome_for_previous_player;
+    Move made_moves[MoveSet::max_number_of_moves];
+    u32 number_of_made_moves = 0;
     SimulationResult simulation_result = {};
 
 #if defined(DEBUG_WRITE_OUT_SIM_RESULT)
@@ -703,74 +1500,64 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
     {
         LOG(g_simresult_fs, "Player about to move: " << PlayerToWord(cur_game_state.player_to_move));
         PrintGameState(cur_game_state, g_simresult_fs);
-        LOGN(g_simresult_fs, "move sequence from state: ");
-        for (u32 movesequence_index = 0; movesequence_index < movesequence_from_position.number_of_moves; ++movesequence_index)
-        {
-            Move move = movesequence_from_position.moves[movesequence_index];
-            assert(move.IsValid());
-            LOGN(g_simresult_fs, MoveToWord(move) << " ");
-        }
-        LOG(g_simresult_fs, "");
     }
 #endif
 
-    // NOTE(david): no randomness were involved, got a proper game out come exactly right after the move sequence was applied to the position
-    u32 movesequence_index = 0;
+    // NOTE(david): no randomness were involved, the game was already over at the leaf, so its outcome is exact
     Player last_player_to_move = (cur_game_state.player_to_move == Player::CIRCLE) ? Player::CROSS : Player::CIRCLE;
     TerminalType last_move_terminal_type = TerminalType::NEUTRAL;
 
-    // make moves to arrive at the position and simulate the rest of the game
-    TIMED_BLOCK(cur_game_state.outcome_for_previous_player = DetermineGameOutcome(cur_game_state, last_player_to_move), JobNames::DetermineGameOutcomeDuringSimulation);
-
-    bool initialized_legal_move_sequence = false;
-    MoveSequence<GRID_DIM_COL * GRID_DIM_ROW> legal_move_sequence = {};
+    // NOTE(david): the dead position is a draw for the search only, the game state itself is played on until the board is full, the leaf outcome is restored at the end
+    // indexed by the Player
+    LineBits<ActiveGameConfig> lines_taken_masks[2] = {};
+    if (detect_dead_positions && cur_game_state.outcome_for_previous_player == GameOutcome::NONE)
+    {
+        lines_taken_masks[(u32)Player::CROSS] = GetLinesTakenMask<ActiveGameConfig>(cur_game_state.move_to_player_map.GetPlayerMask(Player::CROSS));
+        lines_taken_masks[(u32)Player::CIRCLE] = GetLinesTakenMask<ActiveGameConfig>(cur_game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE));
+        if (AreAllLinesTaken<ActiveGameConfig>(lines_taken_masks[(u32)Player::CROSS], lines_taken_masks[(u32)Player::CIRCLE]))
+        {
+            cur_game_state.outcome_for_previous_player = GameOutcome::DRAW;
+        }
+    }
 
+    // simulate the rest of the game
     while (cur_game_state.outcome_for_previous_player == GameOutcome::NONE)
     {
+        last_move_terminal_type = TerminalType::NOT_TERMINAL;
+
+        u32 number_of_legal_moves = cur_game_state.legal_moveset.NumberOfMoves();
+        assert(number_of_legal_moves > 0 && "if there aren't any more legal moves that means DetermineGameOutcomeAfterMove should have returned draw.. to be more precise, this is more of a stalemate position");
+
         Move last_move;
-        last_move.Invalidate();
-        // make a move from the move chain
-        if (movesequence_index < movesequence_from_position.moves_left)
+        BoardMask forced_moves_mask = 0;
+        if (heavy_rollout_policy)
         {
-            last_move = movesequence_from_position.moves[movesequence_index++];
-            
+            Player opponent = cur_game_state.player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
+            TIMED_BLOCK(forced_moves_mask = GetForcedMovesMask<ActiveGameConfig>(cur_game_state.move_to_player_map.GetPlayerMask(cur_game_state.player_to_move), cur_game_state.move_to_player_map.GetPlayerMask(opponent), cur_game_state.legal_moveset.legal_moves_mask), JobNames::GetForcedMovesDuringSimulation);
+        }
+        if (forced_moves_mask != 0)
+        {
+            last_move = Move::MoveFromIndex((u32)_tzcnt_u64(forced_moves_mask));
         }
-        // generate a random move
         else
         {
-            if (initialized_legal_move_sequence == false)
-            {
-                TIMED_BLOCK(
-                    initialized_legal_move_sequence = true;
-                    for (u32 move_index = 0; move_index < ArrayCount(cur_game_state.legal_moveset.moves); ++move_index)
-                    {
-                        if (cur_game_state.legal_moveset.moves[move_index].IsValid())
-                        {
-                            legal_move_sequence.AddMove(cur_game_state.legal_moveset.moves[move_index]);
-                        }
-                    }
-                    , JobNames::InitializeRandomNumberSequenceDuringSimulation
-                );
-            }
-            last_move_terminal_type = TerminalType::NOT_TERMINAL;
-
-            assert(legal_move_sequence.moves_left > 0 && "if there aren't any more legal moves that means DetermineGameOutcomeAfterMove should have returned draw.. to be more precise, this is more of a stalemate position");
-
-            TIMED_BLOCK(u32 random_move_index = GetRandomNumber(0, legal_move_sequence.moves_left - 1), JobNames::GetRandomNumberDuringSimulation);
-            TIMED_BLOCK(last_move = legal_move_sequence.PopMoveAtIndex(random_move_index), JobNames::PopMoveAtIndexDuringSimulation);
+            TIMED_BLOCK(u32 random_move_index = GetRandomNumber(0, number_of_legal_moves - 1), JobNames::GetRandomNumberDuringSimulation);
+            TIMED_BLOCK(last_move = cur_game_state.legal_moveset.GetMoveAtIndex(random_move_index), JobNames::GetMoveAtIndexDuringSimulation);
         }
         assert(last_move.IsValid());
 
-        TIMED_BLOCK(cur_game_state.legal_moveset.DeleteMove(last_move), JobNames::DeleteMoveDuringSimulation);
-
-        TIMED_BLOCK(assert(cur_game_state.move_to_player_map.GetPlayer(last_move) == Player::NONE), JobNames::GetPlayerDuringSimulation);
-        TIMED_BLOCK(cur_game_state.move_to_player_map.AddPlayer(last_move, cur_game_state.player_to_move), JobNames::AddPlayerDuringSimulation);
-
+        assert(cur_game_state.move_to_player_map.GetPlayer(last_move) == Player::NONE);
         last_player_to_move = cur_game_state.player_to_move;
-
-        TIMED_BLOCK(cur_game_state.outcome_for_previous_player = DetermineGameOutcomeAfterMove(cur_game_state, last_player_to_move, last_move), JobNames::DetermineGameOutcomeAfterMoveDuringSimulation);
-
-        cur_game_state.player_to_move = (cur_game_state.player_to_move == Player::CIRCLE) ? Player::CROSS : Player::CIRCLE;
+        TIMED_BLOCK(cur_game_state.MakeMove(last_move), JobNames::MakeMoveDuringSimulation);
+        made_moves[number_of_made_moves++] = last_move;
+        if (detect_dead_positions && cur_game_state.outcome_for_previous_player == GameOutcome::NONE)
+        {
+            lines_taken_masks[(u32)last_player_to_move] |= g_winning_lines<ActiveGameConfig>.line_bits_through_grid[last_move.GetIndex()];
+            if (AreAllLinesTaken<ActiveGameConfig>(lines_taken_masks[(u32)Player::CROSS], lines_taken_masks[(u32)Player::CIRCLE]))
+            {
+                cur_game_state.outcome_for_previous_player = GameOutcome::DRAW;
+            }
+        }
     }
 
     simulation_result.num_simulations = 1;
@@ -786,7 +1573,7 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
                     simulation_result.value = player_that_needs_to_win == last_player_to_move ? 1.0 : -1.0;
                     if (last_move_terminal_type != TerminalType::NOT_TERMINAL)
                     {
-                        node->terminal_info.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::WINNING : TerminalType::LOSING;
+                        simulation_result.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::WINNING : TerminalType::LOSING;
                     }
                 } break ;
                 case Player::CROSS: {
@@ -794,7 +1581,7 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
                     simulation_result.value = player_that_needs_to_win == last_player_to_move ? -1.0 : 1.0;
                     if (last_move_terminal_type != TerminalType::NOT_TERMINAL)
                     {
-                        node->terminal_info.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::LOSING : TerminalType::WINNING;
+                        simulation_result.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::LOSING : TerminalType::WINNING;
                     }
                 } break ;
                 default: UNREACHABLE_CODE;
@@ -807,7 +1594,7 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
                     simulation_result.value = player_that_needs_to_win == last_player_to_move ? -1.0 : 1.0;
                     if (last_move_terminal_type != TerminalType::NOT_TERMINAL)
                     {
-                        node->terminal_info.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::LOSING : TerminalType::WINNING;
+                        simulation_result.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::LOSING : TerminalType::WINNING;
                     }
                 } break ;
                 case Player::CROSS: {
@@ -815,7 +1602,7 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
                     simulation_result.value = player_that_needs_to_win == last_player_to_move ? 1.0 : -1.0;
                     if (last_move_terminal_type != TerminalType::NOT_TERMINAL)
                     {
-                        node->terminal_info.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::WINNING : TerminalType::LOSING;
+                        simulation_result.terminal_type = player_that_needs_to_win == last_player_to_move ? TerminalType::WINNING : TerminalType::LOSING;
                     }
 
                 } break ;
@@ -829,14 +1616,14 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
                     simulation_result.value = 0.0;
                     if (last_move_terminal_type != TerminalType::NOT_TERMINAL)
                     {
-                        node->terminal_info.terminal_type = TerminalType::NEUTRAL;
+                        simulation_result.terminal_type = TerminalType::NEUTRAL;
                     }
                 } break ;
                 case Player::CROSS: {
                     simulation_result.value = 0.0;
                     if (last_move_terminal_type != TerminalType::NOT_TERMINAL)
                     {
-                        node->terminal_info.terminal_type = TerminalType::NEUTRAL;
+                        simulation_result.terminal_type = TerminalType::NEUTRAL;
                     }
                 } break ;
                 default: UNREACHABLE_CODE;
@@ -847,9 +1634,6 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
         }
     }
 
-    node->value += simulation_result.value;
-    node->num_simulations += simulation_result.num_simulations;
-
 #if defined(DEBUG_WRITE_OUT_SIM_RESULT)
     if (g_should_write_out_simulation)
     {
@@ -862,21 +1646,157 @@ SimulationResult simulation_from_position_once(const MoveSequence<max_move_chain
     }
 #endif
 
-    if (movesequence_index != movesequence_from_position.moves_left)
+    while (number_of_made_moves > 0)
     {
-        assert(movesequence_index == movesequence_from_position.moves_left && "still have moves to apply to the position from movesequence so the simulation can't end before that");
+        cur_game_state.UnmakeMove(made_moves[--number_of_made_moves]);
     }
+    cur_game_state.outcome_for_previous_player = leaf_outcome_for_previous_player;
 
     return simulation_result;
 }
 
-SimulationResult simulation_from_position(const MoveSequence<max_move_chain_depth> &movesequence_from_position, const GameState &game_state, Node *node, const NodePool &node_pool)
+// NOTE(david): playouts of the same leaf that are run at the same time by the playout worker pool
+struct PlayoutBatch
 {
-    assert(node->terminal_info.terminal_type == TerminalType::NOT_TERMINAL && "terminal node doesn't have to be simulated");
+    const GameState *leaf_game_state;
+    Player player_to_move_at_root;
+    u32 number_of_playouts_to_start;
+    u32 number_of_playouts_to_finish;
+    SimulationResult simulation_result;
+    condition_variable finished_cv;
+};
 
-    SimulationResult simulation_result_total = {};
+class PlayoutWorkerPool
+{
+public:
+    PlayoutWorkerPool(u32 number_of_workers);
+    ~PlayoutWorkerPool();
+
+    // NOTE(david): runs the playouts of the batch on the workers and on the calling thread, returns when all of them are finished
+    void RunBatch(PlayoutBatch *batch);
+
+private:
+    void _Worker();
+    // ASSUMPTION(david): _mutex is locked and the batch has playouts left to start
+    void _ClaimPlayout(PlayoutBatch *batch);
+    // NOTE(david): runs one playout of the batch and adds its result to the batch, returns with _mutex locked
+    void _RunPlayout(PlayoutBatch *batch, unique_lock<mutex> &pool_lock);
+
+    thread _workers[max_number_of_search_threads];
+    u32 _number_of_workers;
+    deque<PlayoutBatch *> _batches;
+    mutex _mutex;
+    condition_variable _batch_available_cv;
+    bool _is_shutting_down;
+};
+
+PlayoutWorkerPool::PlayoutWorkerPool(u32 number_of_workers)
+    : _number_of_workers(min(number_of_workers, (u32)ArrayCount(_workers))), _is_shutting_down(false)
+{
+    for (u32 worker_index = 0; worker_index < _number_of_workers; ++worker_index)
+    {
+        _workers[worker_index] = thread(&PlayoutWorkerPool::_Worker, this);
+    }
+}
+
+PlayoutWorkerPool::~PlayoutWorkerPool()
+{
+    {
+        lock_guard<mutex> pool_lock(_mutex);
+        _is_shutting_down = true;
+    }
+    _batch_available_cv.notify_all();
+    for (u32 worker_index = 0; worker_index < _number_of_workers; ++worker_index)
+    {
+        _workers[worker_index].join();
+    }
+}
 
-    assert(movesequence_from_position.moves_left > 0 && "must have at least one move to apply to the position");
+void PlayoutWorkerPool::RunBatch(PlayoutBatch *batch)
+{
+    assert(batch->number_of_playouts_to_start == batch->number_of_playouts_to_finish);
+    if (batch->number_of_playouts_to_start == 0)
+    {
+        return ;
+    }
+
+    unique_lock<mutex> pool_lock(_mutex);
+    _batches.push_back(batch);
+    _batch_available_cv.notify_all();
+    // NOTE(david): the calling thread helps with its own batch instead of waiting idle
+    while (batch->number_of_playouts_to_start > 0)
+    {
+        _ClaimPlayout(batch);
+        _RunPlayout(batch, pool_lock);
+    }
+    batch->finished_cv.wait(pool_lock, [batch]() { return batch->number_of_playouts_to_finish == 0; });
+}
+
+void PlayoutWorkerPool::_ClaimPlayout(PlayoutBatch *batch)
+{
+    assert(batch->number_of_playouts_to_start > 0);
+    if (--batch->number_of_playouts_to_start == 0)
+    {
+        auto batch_it = find(_batches.begin(), _batches.end(), batch);
+        assert(batch_it != _batches.end());
+        _batches.erase(batch_it);
+    }
+}
+
+void PlayoutWorkerPool::_RunPlayout(PlayoutBatch *batch, unique_lock<mutex> &pool_lock)
+{
+    pool_lock.unlock();
+    TIMED_BLOCK(SimulationResult simulation_subresult = simulation_from_position_once(GetScratchGameState(*batch->leaf_game_state), batch->player_to_move_at_root), JobNames::SimulationFromPositionOnce);
+    pool_lock.lock();
+
+    batch->simulation_result.value += simulation_subresult.value;
+    batch->simulation_result.num_simulations += simulation_subresult.num_simulations;
+    if (--batch->number_of_playouts_to_finish == 0)
+    {
+        batch->finished_cv.notify_one();
+    }
+}
+
+void PlayoutWorkerPool::_Worker()
+{
+    unique_lock<mutex> pool_lock(_mutex);
+    while (true)
+    {
+        if (_batches.empty())
+        {
+            // NOTE(david): the worker is going idle, so it is a good time to hand over its timings
+            pool_lock.unlock();
+            MERGE_THREAD_JOBS;
+            pool_lock.lock();
+            _batch_available_cv.wait(pool_lock, [this]() { return _is_shutting_down || _batches.empty() == false; });
+        }
+        if (_is_shutting_down)
+        {
+            break ;
+        }
+        PlayoutBatch *batch = _batches.front();
+        _ClaimPlayout(batch);
+        _RunPlayout(batch, pool_lock);
+    }
+}
+
+static PlayoutWorkerPool *GetPlayoutWorkerPool()
+{
+    // NOTE(david): the calling search thread runs one of the playouts itself
+    // hardware_concurrency returns 0 if it can't tell, which would wrap around
+    static PlayoutWorkerPool playout_worker_pool(number_of_playout_threads > 0 ? number_of_playout_threads : max(1u, thread::hardware_concurrency()) - 1);
+    return &playout_worker_pool;
+}
+
+SimulationResult simulation_from_position(GameState &leaf_game_state, Player player_to_move_at_root)
+{
+    if (ShouldSolveEndgame(leaf_game_state))
+    {
+        TIMED_BLOCK(SimulationResult simulation_result = SolveEndgame(leaf_game_state, player_to_move_at_root), JobNames::SolveEndgame);
+        return simulation_result;
+    }
+
+    SimulationResult simulation_result_total = {};
 
     g_should_write_out_simulation = true;
 
@@ -885,72 +1805,151 @@ SimulationResult simulation_from_position(const MoveSequence<max_move_chain_dept
     g_simresult_fs = ofstream("debug/sim_results/sim_result" + to_string(sim_counter++));
 #endif
 
-    // choose the number of simulations based on the number of possible moves
-    assert(game_state.legal_moveset.moves_left >= movesequence_from_position.moves_left);
-    u32 number_of_moves_available_from_position = game_state.legal_moveset.moves_left - movesequence_from_position.moves_left;
-    u32 number_of_simulations_weight = number_of_moves_available_from_position;
-    u32 number_of_simulations = 1;
-    // u32 number_of_simulations = max((u32)1, (u32)(number_of_simulations_weight));
-    // NOTE(david): it will be a terminal move, but it hasn't yet been simulated
-    assert(number_of_simulations > 0 && "assumption, debug to make sure this is true, for example get the selected node and check if it is not terminal yet at this point");
-    for (u32 current_simulation_count = 0;
-         current_simulation_count < number_of_simulations;
-         ++current_simulation_count)
-    {
-        TIMED_BLOCK(SimulationResult simulation_subresult = simulation_from_position_once(movesequence_from_position, game_state, node, node_pool), JobNames::SimulationFromPositionOnce);
-        simulation_result_total.value += simulation_subresult.value;
-        simulation_result_total.num_simulations += simulation_subresult.num_simulations;
+    TIMED_BLOCK(SimulationResult simulation_subresult = simulation_from_position_once(leaf_game_state, player_to_move_at_root), JobNames::SimulationFromPositionOnce);
+    simulation_result_total.value += simulation_subresult.value;
+    simulation_result_total.num_simulations += simulation_subresult.num_simulations;
 
 #if defined(DEBUG_WRITE_OUT_SIM_RESULT)
-        LOGN(g_simresult_fs, node->value << " ");
-        g_should_write_out_simulation = false;
+    LOGN(g_simresult_fs, simulation_result_total.value << " ");
+    g_should_write_out_simulation = false;
 #endif
 
-        if (node->terminal_info.terminal_type != TerminalType::NOT_TERMINAL)
+    if (simulation_subresult.terminal_type != TerminalType::NOT_TERMINAL)
+    {
+        // NOTE(david): the game was over at the leaf, so every other playout would give the same result
+        // MCST updates the terminal type and depth of the node from the result
+        simulation_result_total.terminal_type = simulation_subresult.terminal_type;
+    }
+    else if (number_of_leaf_playouts > 1)
+    {
+        // NOTE(david): leaf parallelization, the rest of the playouts are run at the same time on the playout worker pool
+        PlayoutBatch batch = {};
+        batch.leaf_game_state = &leaf_game_state;
+        batch.player_to_move_at_root = player_to_move_at_root;
+        batch.number_of_playouts_to_start = number_of_leaf_playouts - 1;
+        batch.number_of_playouts_to_finish = number_of_leaf_playouts - 1;
+        GetPlayoutWorkerPool()->RunBatch(&batch);
+        simulation_result_total.value += batch.simulation_result.value;
+        simulation_result_total.num_simulations += batch.simulation_result.num_simulations;
+    }
+
+#if defined(DEBUG_WRITE_OUT_SIM_RESULT)
+    LOG(g_simresult_fs, "");
+#endif
+
+    return simulation_result_total;
+}
+
+// NOTE(david): every lane is a random playout from the same leaf, the lanes advance ply by ply together, so the same player moves in all of them and the won lanes are found at once by DidLastMoveWin
+// only the win check is batched, with AVX2 if it's supported, the moves are chosen and made, and the draws are found, one lane at a time
+// lanes that are finished are masked out, but their boards are still checked until all lanes are finished
+template <typename Config>
+static SimulationResult RolloutLanes(const BasicGameState<Config> &leaf_game_state, Player player_that_needs_to_win)
+{
+    static_assert(number_of_rollout_lanes > 0 && number_of_rollout_lanes <= max_number_of_boards_in_batch, "every lane has to fit into the batch of DidLastMoveWin");
+    assert(leaf_game_state.outcome_for_previous_player == GameOutcome::NONE);
+    assert(player_that_needs_to_win == Player::CROSS && "below values are only for uncontrolled node");
+
+    LineBits<Config> leaf_cross_lines_taken_mask = GetLinesTakenMask<Config>(leaf_game_state.move_to_player_map.GetPlayerMask(Player::CROSS));
+    LineBits<Config> leaf_circle_lines_taken_mask = GetLinesTakenMask<Config>(leaf_game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE));
+    assert((detect_dead_positions == false || AreAllLinesTaken<Config>(leaf_cross_lines_taken_mask, leaf_circle_lines_taken_mask) == false) && "a dead leaf is already a draw");
+
+    // NOTE(david): indexed by the Player, then by the lane
+    BoardMask player_masks[2][number_of_rollout_lanes];
+    LineBits<Config> lines_taken_masks[2][number_of_rollout_lanes];
+    BasicMoveSet<Config> legal_movesets[number_of_rollout_lanes];
+    for (u32 lane_index = 0; lane_index < number_of_rollout_lanes; ++lane_index)
+    {
+        player_masks[(u32)Player::CROSS][lane_index] = leaf_game_state.move_to_player_map.GetPlayerMask(Player::CROSS);
+        player_masks[(u32)Player::CIRCLE][lane_index] = leaf_game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE);
+        lines_taken_masks[(u32)Player::CROSS][lane_index] = leaf_cross_lines_taken_mask;
+        lines_taken_masks[(u32)Player::CIRCLE][lane_index] = leaf_circle_lines_taken_mask;
+        legal_movesets[lane_index] = leaf_game_state.legal_moveset;
+    }
+
+    SimulationResult simulation_result = {};
+    u64 running_lanes = number_of_rollout_lanes == 64 ? ~(u64)0 : ((u64)1 << number_of_rollout_lanes) - 1;
+    Player player_to_move = leaf_game_state.player_to_move;
+    while (running_lanes != 0)
+    {
+        BoardMask *player_to_move_masks = player_masks[(u32)player_to_move];
+        BoardMask *opponent_masks = player_masks[player_to_move == Player::CIRCLE ? (u32)Player::CROSS : (u32)Player::CIRCLE];
+        LineBits<Config> *player_to_move_lines_taken_masks = lines_taken_masks[(u32)player_to_move];
+        for (u64 remaining_lanes = running_lanes; remaining_lanes != 0; remaining_lanes &= remaining_lanes - 1)
         {
-            // TODO(david): move this inside MCST, as the simulation should have as little burden on the node update as possible (optimally 0)
-            switch (node->terminal_info.terminal_type)
+            u32 lane_index = (u32)_tzcnt_u64(remaining_lanes);
+            u32 number_of_legal_moves = legal_movesets[lane_index].NumberOfMoves();
+            assert(number_of_legal_moves > 0 && "a lane without legal moves should have been finished as a draw");
+            BoardMask forced_moves_mask = 0;
+            if (heavy_rollout_policy)
             {
-                case TerminalType::WINNING: {
-                    node->terminal_info.terminal_depth.winning = node->depth;
-                } break ;
-                case TerminalType::LOSING: {
-                    node->terminal_info.terminal_depth.losing = node->depth;
-                } break ;
-                case TerminalType::NEUTRAL: {
-                    node->terminal_info.terminal_depth.neutral = node->depth;
-                } break ;
-                default: UNREACHABLE_CODE;
+                forced_moves_mask = GetForcedMovesMask<Config>(player_to_move_masks[lane_index], opponent_masks[lane_index], legal_movesets[lane_index].legal_moves_mask);
             }
-            // number_of_simulations = 1;
-            // number_of_simulations = max((u32)1, (u32)(number_of_simulations_weight));
-            // assert(node->num_simulations == 1);
+            BasicMove<Config> move = forced_moves_mask != 0 ?
+                BasicMove<Config>::MoveFromIndex((u32)_tzcnt_u64(forced_moves_mask)) :
+                legal_movesets[lane_index].GetMoveAtIndex(GetRandomNumber(0, number_of_legal_moves - 1));
+            legal_movesets[lane_index].DeleteMove(move);
+            player_to_move_masks[lane_index] |= (BoardMask)1 << move.GetIndex();
+            player_to_move_lines_taken_masks[lane_index] |= g_winning_lines<Config>.line_bits_through_grid[move.GetIndex()];
+        }
 
-            // node->value *= number_of_simulations;
+        u64 won_lanes = DidLastMoveWin<Config>(player_to_move_masks, number_of_rollout_lanes) & running_lanes;
+        running_lanes &= ~won_lanes;
+        // NOTE(david): same values as the ones of simulation_from_position_once
+        simulation_result.value += (r32)__popcnt64(won_lanes) * (player_to_move == player_that_needs_to_win ? -1.0f : 1.0f);
 
-            assert(current_simulation_count == 0);
-            break ;
+        u64 drawn_lanes = 0;
+        for (u64 remaining_lanes = running_lanes; remaining_lanes != 0; remaining_lanes &= remaining_lanes - 1)
+        {
+            u32 lane_index = (u32)_tzcnt_u64(remaining_lanes);
+            if (legal_movesets[lane_index].NumberOfMoves() == 0 || (detect_dead_positions && AreAllLinesTaken<Config>(lines_taken_masks[(u32)Player::CROSS][lane_index], lines_taken_masks[(u32)Player::CIRCLE][lane_index])))
+            {
+                drawn_lanes |= (u64)1 << lane_index;
+            }
         }
+        running_lanes &= ~drawn_lanes;
+
+        player_to_move = player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE;
     }
+    simulation_result.num_simulations = number_of_rollout_lanes;
 
-#if defined(DEBUG_WRITE_OUT_SIM_RESULT)
-    LOG(g_simresult_fs, "");
-#endif
+    return simulation_result;
+}
 
-    return simulation_result_total;
+// NOTE(david): alternative of simulation_from_position, runs number_of_rollout_lanes playouts from the leaf on the calling thread with RolloutLanes
+SimulationResult simulation_from_position_lanes(GameState &leaf_game_state, Player player_to_move_at_root)
+{
+    if (ShouldSolveEndgame(leaf_game_state))
+    {
+        TIMED_BLOCK(SimulationResult simulation_result = SolveEndgame(leaf_game_state, player_to_move_at_root), JobNames::SolveEndgame);
+        return simulation_result;
+    }
+
+    if (leaf_game_state.outcome_for_previous_player != GameOutcome::NONE ||
+        (detect_dead_positions && IsDeadPosition<ActiveGameConfig>(leaf_game_state.move_to_player_map.GetPlayerMask(Player::CROSS), leaf_game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE))))
+    {
+        // NOTE(david): the game was over at the leaf, every playout would give the same result, this one also sets the terminal type for MCST
+        TIMED_BLOCK(SimulationResult simulation_result = simulation_from_position_once(leaf_game_state, player_to_move_at_root), JobNames::SimulationFromPositionOnce);
+        return simulation_result;
+    }
+
+    TIMED_BLOCK(SimulationResult simulation_result = RolloutLanes(leaf_game_state, player_to_move_at_root), JobNames::RolloutLanes);
+
+    return simulation_result;
 }
 
-static void InitializeGameState(GameState *game_state)
+template <typename Config>
+static void InitializeGameState(BasicGameState<Config> *game_state)
 {
     *game_state = {};
     game_state->player_to_move = Player::CIRCLE;
     game_state->move_to_player_map.Clear();
     game_state->legal_moveset.Clear();
-    for (u32 row = 0; row < GRID_DIM_ROW; ++row)
+    for (u32 row = 0; row < Config::rows; ++row)
     {
-        for (u32 col = 0; col < GRID_DIM_COL; ++col)
+        for (u32 col = 0; col < Config::cols; ++col)
         {
-            Move move = { row, col };
+            BasicMove<Config> move = BasicMove<Config>::MoveFromRowCol(row, col);
             game_state->legal_moveset.AddMove(move);
         }
     }
@@ -958,6 +1957,193 @@ static void InitializeGameState(GameState *game_state)
     game_state->outcome_for_previous_player = DetermineGameOutcome(*game_state, previous_player);
 }
 
+#if defined(DEBUG_CHECK_GAME_RULES)
+// NOTE(david): plain negamax without pruning and without the table, same scores as SolveEndgameHelper, the dead positions are found by going through every line
+template <typename Config>
+static i32 DebugSolveByNegamax(BasicGameState<Config> &game_state)
+{
+    switch (game_state.outcome_for_previous_player)
+    {
+        case GameOutcome::WIN: {
+            return -endgame_win_score<Config>;
+        } break ;
+        case GameOutcome::DRAW: {
+            return 0;
+        } break ;
+        case GameOutcome::NONE: {
+        } break ;
+        default: UNREACHABLE_CODE;
+    }
+    if (detect_dead_positions && IsDeadPosition<Config>(game_state.move_to_player_map.GetPlayerMask(Player::CROSS), game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE)))
+    {
+        return 0;
+    }
+
+    i32 best_score = -endgame_win_score<Config> - 1;
+    for (BoardMask remaining_moves_mask = game_state.legal_moveset.legal_moves_mask; remaining_moves_mask != 0; remaining_moves_mask &= remaining_moves_mask - 1)
+    {
+        BasicMove<Config> move = BasicMove<Config>::MoveFromIndex((u32)_tzcnt_u64(remaining_moves_mask));
+        game_state.MakeMove(move);
+        best_score = max(best_score, EndgameScoreFromChildScore(DebugSolveByNegamax(game_state)));
+        game_state.UnmakeMove(move);
+    }
+
+    return best_score;
+}
+
+// NOTE(david): the search only instantiates the rules for the active variant, so every variant is played here with random moves, and the fast forms of the rules are checked against the obvious ones on the way
+template <typename Config>
+static void DebugCheckGameRules(u32 number_of_games)
+{
+    // NOTE(david): the negamax visits every continuation, so it's only affordable close to the end of the game
+    constexpr u32 max_number_of_empty_grids_to_solve = 7;
+
+    for (u32 game_index = 0; game_index < number_of_games; ++game_index)
+    {
+        BasicGameState<Config> game_state;
+        InitializeGameState(&game_state);
+        BasicGameState<Config> initial_game_state = game_state;
+        BasicMove<Config> made_moves[Config::number_of_grids];
+        u32 number_of_made_moves = 0;
+        // NOTE(david): indexed by the Player
+        LineBits<Config> lines_taken_masks[2] = {};
+        while (game_state.outcome_for_previous_player == GameOutcome::NONE)
+        {
+            u32 number_of_legal_moves = game_state.legal_moveset.NumberOfMoves();
+            assert(number_of_legal_moves == game_state.move_to_player_map.available_grids);
+
+            if (detect_dead_positions == false || AreAllLinesTaken<Config>(lines_taken_masks[(u32)Player::CROSS], lines_taken_masks[(u32)Player::CIRCLE]) == false)
+            {
+                SimulationResult rollout_result = RolloutLanes(game_state, Player::CROSS);
+                assert(rollout_result.num_simulations == number_of_rollout_lanes && fabs(rollout_result.value) <= (r32)number_of_rollout_lanes);
+            }
+            if (number_of_legal_moves <= max_number_of_empty_grids_to_solve)
+            {
+                i32 score = DebugSolveByNegamax(game_state);
+                SimulationResult solved_result = SolveEndgame(game_state, Player::CROSS);
+                if (score == 0)
+                {
+                    assert(solved_result.terminal_type == TerminalType::NEUTRAL);
+                }
+                else
+                {
+                    Player winner = score > 0 ? game_state.player_to_move : (game_state.player_to_move == Player::CIRCLE ? Player::CROSS : Player::CIRCLE);
+                    assert(solved_result.terminal_type == (winner == Player::CROSS ? TerminalType::LOSING : TerminalType::WINNING));
+                    assert(solved_result.plies_to_terminal == endgame_win_score<Config> - abs(score));
+                }
+            }
+
+            BasicMove<Config> move = game_state.legal_moveset.GetMoveAtIndex(GetRandomNumber(0, number_of_legal_moves - 1));
+            assert(game_state.legal_moveset.GetFirstMoveFrom(move.GetIndex()) == move);
+            Player player = game_state.player_to_move;
+            u64 zobrist_hash_after_move = game_state.ZobristHashAfterMove(move);
+            game_state.MakeMove(move);
+            made_moves[number_of_made_moves++] = move;
+            assert(game_state.move_to_player_map.zobrist_hash == zobrist_hash_after_move);
+            assert(game_state.move_to_player_map.GetPlayer(move) == player);
+
+            BoardMask player_mask = game_state.move_to_player_map.GetPlayerMask(player);
+            bool did_win = DidLastMoveWin<Config>(&player_mask, 1) != 0;
+            assert(did_win == (game_state.outcome_for_previous_player == GameOutcome::WIN));
+            assert(did_win == (DetermineGameOutcome(game_state, player) == GameOutcome::WIN));
+            // NOTE(david): the game is only drawn by a full board, the dead positions are left to the search
+            assert((game_state.outcome_for_previous_player == GameOutcome::DRAW) == (did_win == false && game_state.move_to_player_map.IsFull()));
+
+            BoardMask opponent_mask = game_state.move_to_player_map.GetPlayerMask(game_state.player_to_move);
+            lines_taken_masks[(u32)player] |= g_winning_lines<Config>.line_bits_through_grid[move.GetIndex()];
+            assert(lines_taken_masks[(u32)player] == GetLinesTakenMask<Config>(player_mask));
+            bool is_dead_position = IsDeadPosition<Config>(game_state.move_to_player_map.GetPlayerMask(Player::CROSS), game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE));
+            assert(is_dead_position == AreAllLinesTaken<Config>(lines_taken_masks[(u32)Player::CROSS], lines_taken_masks[(u32)Player::CIRCLE]));
+            if (is_dead_position)
+            {
+                assert(GetWinningMovesMask<Config>(player_mask, game_state.legal_moveset.legal_moves_mask) == 0);
+                assert(GetWinningMovesMask<Config>(opponent_mask, game_state.legal_moveset.legal_moves_mask) == 0);
+            }
+        }
+
+        while (number_of_made_moves > 0)
+        {
+            game_state.UnmakeMove(made_moves[--number_of_made_moves]);
+        }
+        assert(game_state.player_to_move == initial_game_state.player_to_move);
+        assert(game_state.legal_moveset.legal_moves_mask == initial_game_state.legal_moveset.legal_moves_mask);
+        assert(game_state.move_to_player_map.available_grids == initial_game_state.move_to_player_map.available_grids);
+        assert(game_state.move_to_player_map.zobrist_hash == initial_game_state.move_to_player_map.zobrist_hash);
+        assert(game_state.move_to_player_map.GetPlayerMask(Player::CROSS) == 0 && game_state.move_to_player_map.GetPlayerMask(Player::CIRCLE) == 0);
+    }
+}
+
+static void DebugCheckGameVariants(void)
+{
+    constexpr u32 number_of_games_per_variant = 64;
+    DebugCheckGameRules<GameConfig<3, 3, 3>>(number_of_games_per_variant);
+    DebugCheckGameRules<ActiveGameConfig>(number_of_games_per_variant);
+    DebugCheckGameRules<GameConfig<7, 7, 5>>(number_of_games_per_variant);
+    DebugCheckGameRules<GameConfig<8, 8, 4>>(number_of_games_per_variant);
+
+    BasicGameState<GameConfig<3, 3, 3>> tic_tac_toe_game_state;
+    InitializeGameState(&tic_tac_toe_game_state);
+    assert(SolveEndgame(tic_tac_toe_game_state, Player::CROSS).terminal_type == TerminalType::NEUTRAL && "tic-tac-toe is a draw");
+}
+#endif
+
+#if defined(DEBUG_CHECK_PLAYOUT_WORKER_POOL)
+// NOTE(david): the search ships with one playout per leaf, so the batches of the playout worker pool are only run here, from several search threads at the same time, the same way simulation_from_position runs them
+static void DebugCheckPlayoutWorkerPool(void)
+{
+    constexpr u32 number_of_workers = 3;
+    constexpr u32 number_of_search_threads_to_check = 4;
+    constexpr u32 number_of_batches_per_search_thread = 256;
+    constexpr u32 number_of_playouts_per_batch = 8;
+
+    PlayoutWorkerPool playout_worker_pool(number_of_workers);
+    atomic<u32> number_of_finished_playouts = 0;
+    thread search_threads[number_of_search_threads_to_check];
+    for (u32 search_thread_index = 0; search_thread_index < number_of_search_threads_to_check; ++search_thread_index)
+    {
+        search_threads[search_thread_index] = thread([&playout_worker_pool, &number_of_finished_playouts, search_thread_index]() {
+            SetRandomStream(0, search_thread_index);
+            for (u32 batch_index = 0; batch_index < number_of_batches_per_search_thread; ++batch_index)
+            {
+                // NOTE(david): a few random moves from the start, so that the leaves differ between the batches
+                GameState leaf_game_state;
+                InitializeGameState(&leaf_game_state);
+                u32 number_of_moves_to_make = (u32)GetRandomNumber(0, 6);
+                for (u32 move_index = 0; move_index < number_of_moves_to_make && leaf_game_state.outcome_for_previous_player == GameOutcome::NONE; ++move_index)
+                {
+                    leaf_game_state.MakeMove(leaf_game_state.legal_moveset.GetMoveAtIndex(GetRandomNumber(0, leaf_game_state.legal_moveset.NumberOfMoves() - 1)));
+                }
+                if (leaf_game_state.outcome_for_previous_player != GameOutcome::NONE)
+                {
+                    continue ;
+                }
+                GameState leaf_game_state_before_batch = leaf_game_state;
+
+                PlayoutBatch batch = {};
+                batch.leaf_game_state = &leaf_game_state;
+                batch.player_to_move_at_root = Player::CROSS;
+                batch.number_of_playouts_to_start = number_of_playouts_per_batch;
+                batch.number_of_playouts_to_finish = number_of_playouts_per_batch;
+                playout_worker_pool.RunBatch(&batch);
+
+                assert(batch.number_of_playouts_to_start == 0 && batch.number_of_playouts_to_finish == 0);
+                assert(batch.simulation_result.num_simulations == number_of_playouts_per_batch);
+                assert(fabs(batch.simulation_result.value) <= (r32)number_of_playouts_per_batch);
+                assert(leaf_game_state.move_to_player_map.zobrist_hash == leaf_game_state_before_batch.move_to_player_map.zobrist_hash);
+                assert(leaf_game_state.legal_moveset.legal_moves_mask == leaf_game_state_before_batch.legal_moveset.legal_moves_mask);
+                assert(leaf_game_state.outcome_for_previous_player == GameOutcome::NONE);
+                number_of_finished_playouts += batch.simulation_result.num_simulations;
+            }
+        });
+    }
+    for (u32 search_thread_index = 0; search_thread_index < number_of_search_threads_to_check; ++search_thread_index)
+    {
+        search_threads[search_thread_index].join();
+    }
+    assert(number_of_finished_playouts.load() > 0 && number_of_finished_playouts.load() % number_of_playouts_per_batch == 0);
+}
+#endif
+
 struct GameWindow
 {
     u32 width;
@@ -969,39 +2155,42 @@ Move g_selected_move;
 bool g_evaluate_thread_is_working = false;
 thread g_evaluate_thread;
 
-static void EvaluateMove(GameState *game_state, MCST *mcst, NodePool *node_pool, std::chrono::milliseconds max_evaluation_time)
+static void EvaluateMove(GameState *game_state, MCSTEnsemble *mcst, std::chrono::milliseconds max_evaluation_time)
 {
-    bool force_end_of_evaluation = false;
+    atomic<bool> force_end_of_evaluation = false;
     bool stop_parent_sleep = false;
+    mutex stop_parent_sleep_mutex;
+    condition_variable stop_parent_sleep_cv;
     Move selected_move;
     auto start_time = std::chrono::steady_clock::now();
-    thread t([&selected_move, &stop_parent_sleep, &force_end_of_evaluation](GameState *game_state, MCST *mcst, NodePool *node_pool) {
+    thread t([&selected_move, &stop_parent_sleep, &stop_parent_sleep_mutex, &stop_parent_sleep_cv, &force_end_of_evaluation](GameState *game_state, MCSTEnsemble *mcst) {
         try
         {
             r64 evaluate_time_result_m = 0.0;
-            TIMED_BLOCK(selected_move = mcst->Evaluate(game_state->legal_moveset, [&stop_parent_sleep, &force_end_of_evaluation](bool found_move){
+            TIMED_BLOCK(selected_move = mcst->Evaluate(game_state->legal_moveset, [&stop_parent_sleep, &stop_parent_sleep_mutex, &stop_parent_sleep_cv, &force_end_of_evaluation](bool found_move){
                 if (found_move)
                 {
-                    stop_parent_sleep = true;
+                    {
+                        lock_guard<mutex> stop_parent_sleep_lock(stop_parent_sleep_mutex);
+                        stop_parent_sleep = true;
+                    }
+                    stop_parent_sleep_cv.notify_one();
                     return true;
                 }
-                return force_end_of_evaluation;
-            }, simulation_from_position, *node_pool, *game_state), JobNames::Evaluate);
+                return force_end_of_evaluation.load(memory_order_relaxed);
+            }, lane_parallel_rollouts ? simulation_from_position_lanes : simulation_from_position, *game_state), JobNames::Evaluate);
+            MERGE_THREAD_JOBS;
         }
         catch (exception &e)
         {
             LOG(cerr, e.what());
             exit(1);
         }
-    }, game_state, mcst, node_pool);
+    }, game_state, mcst);
 
-    while (std::chrono::steady_clock::now() - start_time < max_evaluation_time)
     {
-        if (stop_parent_sleep)
-        {
-            break;
-        }
-        this_thread::sleep_for(1ms);
+        unique_lock<mutex> stop_parent_sleep_lock(stop_parent_sleep_mutex);
+        stop_parent_sleep_cv.wait_until(stop_parent_sleep_lock, start_time + max_evaluation_time, [&stop_parent_sleep]() { return stop_parent_sleep; });
     }
     force_end_of_evaluation = true;
     t.join();
@@ -1010,8 +2199,10 @@ static void EvaluateMove(GameState *game_state, MCST *mcst, NodePool *node_pool,
     g_finished_evaluation = true;
 }
 
-static void UpdateMove(GameState *game_state, Move move)
+static void UpdateMove(GameState *game_state, Move move, MCSTEnsemble *mcst)
 {
+    mcst->AdvanceRoot(move);
+
     game_state->legal_moveset.DeleteMove(move);
 
     assert(game_state->move_to_player_map.GetPlayer(move) == Player::NONE);
@@ -1051,7 +2242,7 @@ static void UpdateMove(GameState *game_state, Move move)
     ++g_move_counter;
 }
 
-static void UpdateGameState(GameState *game_state, MCST *mcst, NodePool *node_pool, GameWindow *game_window)
+static void UpdateGameState(GameState *game_state, MCSTEnsemble *mcst, GameWindow *game_window)
 {
     if (game_state->outcome_for_previous_player == GameOutcome::NONE)
     {
@@ -1064,9 +2255,9 @@ static void UpdateGameState(GameState *game_state, MCST *mcst, NodePool *node_po
                 {
                     g_selected_move.Invalidate();
                     g_evaluate_thread_is_working = true;
-                    g_evaluate_thread = thread([](GameState *game_state, MCST *mcst, NodePool *node_pool, std::chrono::milliseconds max_evaluation_time) {
-                        EvaluateMove(game_state, mcst, node_pool, max_evaluation_time);
-                    }, game_state, mcst, node_pool, max_evaluation_time);
+                    g_evaluate_thread = thread([](GameState *game_state, MCSTEnsemble *mcst, std::chrono::milliseconds max_evaluation_time) {
+                        EvaluateMove(game_state, mcst, max_evaluation_time);
+                    }, game_state, mcst, max_evaluation_time);
                 }
             }
             else
@@ -1080,11 +2271,12 @@ static void UpdateGameState(GameState *game_state, MCST *mcst, NodePool *node_po
                 ofstream timed_block_ofs("debug/timed_blocks/timed_block" + to_string(timed_blocks_counter++));
                 LOG_JOBS(timed_block_ofs);
                 CLEAR_JOBS;
-                LOG(cout, "Currently allocated nodes: " << node_pool->CurrentAllocatedNodes());
-                LOG(cout, "Total freed nodes: " << node_pool->TotalNumberOfFreedNodes());
+                LOG(cout, "Currently allocated nodes: " << mcst->CurrentAllocatedNodes());
+                LOG(cout, "Total freed nodes: " << mcst->TotalNumberOfFreedNodes());
+                LOG(cout, "Committed node pool memory: " << mcst->CurrentCommittedMemory() / (1024 * 1024) << "MB");
                 if (g_selected_move.IsValid())
                 {
-                    UpdateMove(game_state, g_selected_move);
+                    UpdateMove(game_state, g_selected_move, mcst);
                 }
                 else
                 {
@@ -1098,12 +2290,12 @@ static void UpdateGameState(GameState *game_state, MCST *mcst, NodePool *node_po
             Vector2 mouse_position = GetMousePosition();
             if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
             {
-                u32 selected_grid_col = (u32)(mouse_position.x * GRID_DIM_COL / game_window->width);
-                u32 selected_grid_row = (u32)(mouse_position.y * GRID_DIM_ROW / game_window->height);
-                Move selected_move = { selected_grid_row, selected_grid_col };
-                if (game_state->move_to_player_map.GetPlayer(selected_move) == Player::NONE)
+                u32 selected_grid_col = (u32)(mouse_position.x * ActiveGameConfig::cols / game_window->width);
+                u32 selected_grid_row = (u32)(mouse_position.y * ActiveGameConfig::rows / game_window->height);
+                Move selected_move = Move::MoveFromRowCol(selected_grid_row, selected_grid_col);
+                if (selected_move.IsValid() && game_state->move_to_player_map.GetPlayer(selected_move) == Player::NONE)
                 {
-                    UpdateMove(game_state, selected_move);
+                    UpdateMove(game_state, selected_move, mcst);
                 }
             }
         }
@@ -1112,6 +2304,7 @@ static void UpdateGameState(GameState *game_state, MCST *mcst, NodePool *node_po
     {
         if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
         {
+            mcst->ResetTree();
             InitializeGameState(game_state);
         }
     }
@@ -1120,26 +2313,26 @@ static void UpdateGameState(GameState *game_state, MCST *mcst, NodePool *node_po
 static void RenderGameState(GameState *game_state, GameWindow *game_window)
 {
     constexpr r32 grid_line_thickness = 3.5f;
-    for (u32 row = 0; row < GRID_DIM_ROW - 1; ++row)
+    for (u32 row = 0; row < ActiveGameConfig::rows - 1; ++row)
     {
-        Vector2 horizontal_start = { 0.0f, (r32)game_window->height * (row + 1) / (r32)GRID_DIM_ROW };
-        Vector2 horizontal_end = { (r32)game_window->width, (r32)game_window->height * (row + 1) / (r32)GRID_DIM_ROW };
+        Vector2 horizontal_start = { 0.0f, (r32)game_window->height * (row + 1) / (r32)ActiveGameConfig::rows };
+        Vector2 horizontal_end = { (r32)game_window->width, (r32)game_window->height * (row + 1) / (r32)ActiveGameConfig::rows };
         DrawLineEx(horizontal_start, horizontal_end, grid_line_thickness, BLACK);
     }
-    for (u32 col = 0; col < GRID_DIM_COL - 1; ++col)
+    for (u32 col = 0; col < ActiveGameConfig::cols - 1; ++col)
     {
-        Vector2 vertical_start = { (r32)game_window->width * (col + 1) / (r32)GRID_DIM_COL, 0.0f };
-        Vector2 vertical_end = { (r32)game_window->width * (col + 1) / (r32)GRID_DIM_COL, (r32)game_window->height };
+        Vector2 vertical_start = { (r32)game_window->width * (col + 1) / (r32)ActiveGameConfig::cols, 0.0f };
+        Vector2 vertical_end = { (r32)game_window->width * (col + 1) / (r32)ActiveGameConfig::cols, (r32)game_window->height };
         DrawLineEx(vertical_start, vertical_end, grid_line_thickness, BLACK);
     }
 
-    for (u32 row = 0; row < GRID_DIM_ROW; ++row)
+    for (u32 row = 0; row < ActiveGameConfig::rows; ++row)
     {
-        for (u32 col = 0; col < GRID_DIM_COL; ++col)
+        for (u32 col = 0; col < ActiveGameConfig::cols; ++col)
         {
-            Move move = { row, col };
-            Vector2 grid_offset = { (r32)game_window->width / (r32)GRID_DIM_COL * (r32)col, (r32)game_window->height / (r32)GRID_DIM_ROW * (r32)row };
-            Vector2 grid_size   = { (r32)game_window->width / (r32)GRID_DIM_COL, (r32)game_window->height / (r32)GRID_DIM_ROW };
+            Move move = Move::MoveFromRowCol(row, col);
+            Vector2 grid_offset = { (r32)game_window->width / (r32)ActiveGameConfig::cols * (r32)col, (r32)game_window->height / (r32)ActiveGameConfig::rows * (r32)row };
+            Vector2 grid_size   = { (r32)game_window->width / (r32)ActiveGameConfig::cols, (r32)game_window->height / (r32)ActiveGameConfig::rows };
             constexpr r32 size_ratio = 0.8f;
             switch (game_state->move_to_player_map.GetPlayer(move))
             {
@@ -1165,19 +2358,34 @@ static void RenderGameState(GameState *game_state, GameWindow *game_window)
 
 i32 main()
 {
+    if (IsPopcntSupported() == false)
+    {
+        LOG(cerr, "the processor doesn't support POPCNT, which is the minimum instruction set");
+        return 1;
+    }
+#if defined(DEBUG_CHECK_GAME_RULES)
+    DebugCheckGameVariants();
+#endif
+#if defined(DEBUG_CHECK_PLAYOUT_WORKER_POOL)
+    DebugCheckPlayoutWorkerPool();
+#endif
+
     GameWindow game_window = { 800, 600 };
     InitWindow(game_window.width, game_window.height, "Tic-Tac-Toe");
 
     SetTargetFPS(60);
 
-    constexpr NodeIndex node_pool_size = 2097152;
-    NodePool node_pool(node_pool_size);
-    MCST mcst;
+    // NOTE(david): the node pools grow on demand up to this memory ceiling
+    constexpr u64 node_pool_memory_ceiling_in_bytes = 1024ull * 1024 * 1024;
+    u32 number_of_threads = number_of_search_threads > 0 ? number_of_search_threads : thread::hardware_concurrency();
+    u32 number_of_trees = root_parallel_search ? number_of_threads : 1;
+    u32 number_of_threads_per_tree = root_parallel_search ? 1 : number_of_threads;
+    MCSTEnsemble mcst(number_of_trees, number_of_threads_per_tree, node_pool_memory_ceiling_in_bytes, reuse_search_tree, evict_cold_subtrees);
 
     // u32 number_of_wins = 0;
     // u32 number_of_losses = 0;
     // u32 number_of_draws = 0;
-    gen.seed(0);
+    g_random_seed = 0;
     GameState game_state;
     g_selected_move.Invalidate();
     InitializeGameState(&game_state);
@@ -1186,7 +2394,7 @@ i32 main()
         BeginDrawing();
         ClearBackground(WHITE);
 
-        UpdateGameState(&game_state, &mcst, &node_pool, &game_window);
+        UpdateGameState(&game_state, &mcst, &game_window);
         RenderGameState(&game_state, &game_window);
 
         EndDrawing();